@@ -0,0 +1,343 @@
+// simzip: simulate streams through a zipper merge to tune latency.
+//
+// Reads a JSON configuration of stream models, drives a merge on a
+// simulated clock for each latency setting to sweep, in parallel, and
+// reports throughput, loss rate and latency percentiles.
+//
+//   $ simzip apps/simzip.json
+//
+// See apps/simzip.json for an example configuration.  All times are
+// in seconds.
+//
+// {
+//   "duration": 1.0,        // simulated time
+//   "drain_period": 1e-4,   // how often the consumer drains, 0 for every feed
+//   "cardinality": 0,       // 0, the default, is the number of streams
+//   "latencies": [...],     // max latency settings to sweep, 0 is lossless
+//   "adapt": {"target_loss": 1e-3, "lo": null}, // adapt budgets up to each
+//                           // latency, lo defaults to the smallest stream period
+//   "threads": 0,           // default is all cores
+//   "seed": 1,
+//   "streams": [{
+//       "count": 1,         // number of identical streams
+//       "rate": 1e5,        // nodes per second
+//       "delay": 0,         // fixed transport delay
+//       "jitter": 0,        // mean of exponential extra delay
+//       "burst": 1,         // nodes delivered together
+//       "outage": {"rate": 0, "length": 0}, // per second, duration
+//       "latency": null     // own latency budget, default from sweep
+//   }]
+// }
+
+#include "zipper.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+using clock_t_ = zipper::logical_clock;
+using timepoint_t = clock_t_::time_point;
+using duration_t = clock_t_::duration;
+using node_t = zipper::Node<int64_t, int64_t, size_t, timepoint_t>;
+using merge_t = zipper::merge<node_t>;
+
+duration_t seconds(double sec)
+{
+    return std::chrono::duration_cast<duration_t>(std::chrono::duration<double>(sec));
+}
+
+double seconds(duration_t dur)
+{
+    return std::chrono::duration<double>(dur).count();
+}
+
+struct Stream {
+    double rate{1e5}, delay{0}, jitter{0};
+    size_t burst{1};
+    double outage_rate{0}, outage_length{0};
+    double latency{-1};         // negative means use the sweep setting
+};
+
+struct Config {
+    double duration{1.0};
+    double drain_period{1e-4};
+    size_t cardinality{0};
+    std::vector<double> latencies{0};
+    double adapt_target{0}, adapt_lo{0};
+    size_t threads{0};
+    unsigned seed{1};
+    std::vector<Stream> streams; // one per identity
+};
+
+Config parse(const json& jcfg)
+{
+    Config cfg;
+    cfg.duration = jcfg.value("duration", cfg.duration);
+    cfg.drain_period = jcfg.value("drain_period", cfg.drain_period);
+    cfg.latencies = jcfg.value("latencies", cfg.latencies);
+    if (jcfg.contains("adapt")) {
+        const auto& ja = jcfg["adapt"];
+        cfg.adapt_target = ja.value("target_loss", 0.0);
+        if (!(cfg.adapt_target > 0 && cfg.adapt_target < 1)) {
+            throw std::invalid_argument("adapt target_loss must be in (0, 1)");
+        }
+        if (ja.contains("lo") && !ja["lo"].is_null()) {
+            cfg.adapt_lo = ja["lo"].get<double>();
+            if (!(cfg.adapt_lo > 0)) {
+                throw std::invalid_argument("adapt lo must be positive");
+            }
+        }
+    }
+    cfg.threads = jcfg.value("threads", cfg.threads);
+    cfg.seed = jcfg.value("seed", cfg.seed);
+    for (const auto& js : jcfg.at("streams")) {
+        Stream s;
+        s.rate = js.value("rate", s.rate);
+        s.delay = js.value("delay", s.delay);
+        s.jitter = js.value("jitter", s.jitter);
+        s.burst = std::max<size_t>(1, js.value("burst", s.burst));
+        if (js.contains("outage")) {
+            s.outage_rate = js["outage"].value("rate", 0.0);
+            s.outage_length = js["outage"].value("length", 0.0);
+        }
+        if (js.contains("latency") && !js["latency"].is_null()) {
+            s.latency = js["latency"].get<double>();
+        }
+        const size_t count = js.value("count", 1);
+        for (size_t ind = 0; ind < count; ++ind) {
+            cfg.streams.push_back(s);
+        }
+    }
+    cfg.cardinality = jcfg.value("cardinality", size_t(0));
+    if (cfg.cardinality == 0) {
+        cfg.cardinality = cfg.streams.size();
+    }
+    if (cfg.adapt_target > 0 && cfg.adapt_lo == 0) {
+        for (const auto& s : cfg.streams) {
+            const double period = 1/s.rate;
+            if (cfg.adapt_lo == 0 || period < cfg.adapt_lo) {
+                cfg.adapt_lo = period;
+            }
+        }
+    }
+    return cfg;
+}
+
+// A node arriving at the merge.
+struct Arrival {
+    timepoint_t when;
+    int64_t ordering;           // data time in ns
+    size_t ident;
+};
+
+// Generate one stream's arrivals, in order of arrival.
+void generate(const Stream& s, size_t ident, double duration,
+              std::mt19937_64& rng, std::vector<Arrival>& out)
+{
+    std::uniform_real_distribution<double> uni(0, 1);
+    std::exponential_distribution<double> jitter(s.jitter > 0 ? 1/s.jitter : 1);
+
+    // outage intervals
+    std::vector<std::pair<double,double>> outages;
+    if (s.outage_rate > 0) {
+        std::exponential_distribution<double> gap(s.outage_rate);
+        for (double t = gap(rng); t < duration; t += s.outage_length + gap(rng)) {
+            outages.emplace_back(t, t + s.outage_length);
+        }
+    }
+
+    const double period = 1.0/s.rate;
+    size_t iout = 0;
+    double last = 0;
+    std::vector<Arrival> group;
+    for (double data = uni(rng)*period; data < duration; data += period) {
+        while (iout < outages.size() && outages[iout].second <= data) {
+            ++iout;
+        }
+        double sent = data;
+        if (iout < outages.size() && outages[iout].first <= data) {
+            sent = outages[iout].second; // held until link recovers
+        }
+        double when = sent + s.delay + (s.jitter > 0 ? jitter(rng) : 0);
+        when = std::max(when, last); // links deliver in order
+        last = when;
+
+        group.push_back(Arrival{timepoint_t(seconds(when)),
+                                (int64_t)(data*1e9), ident});
+        if (group.size() == s.burst) {
+            for (auto& one : group) {
+                one.when = group.back().when;
+                out.push_back(one);
+            }
+            group.clear();
+        }
+    }
+    out.insert(out.end(), group.begin(), group.end());
+}
+
+struct Result {
+    double latency{0};
+    size_t fed{0}, lost{0}, drained{0}, left{0}, stale{0};
+    double p50{0}, p90{0}, p99{0}, pmax{0}; // seconds in merge
+    double wall{0};
+};
+
+double quantile(std::vector<int64_t>& vals, double q)
+{
+    if (vals.empty()) {
+        return 0;
+    }
+    const size_t ind = std::min(vals.size()-1, (size_t)(q*vals.size()));
+    std::nth_element(vals.begin(), vals.begin()+ind, vals.end());
+    return vals[ind]*1e-9;
+}
+
+Result simulate(const Config& cfg, const std::vector<Arrival>& arrivals, double latency)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    Result res;
+    res.latency = latency;
+
+    merge_t mq(cfg.cardinality, seconds(latency));
+    if (cfg.adapt_target > 0 && latency > 0) {
+        const auto lo = std::max(seconds(std::min(cfg.adapt_lo, latency)),
+                                 duration_t(1));
+        mq.adapt_latency(cfg.adapt_target, lo, seconds(latency));
+    }
+    for (size_t ident = 0; ident < cfg.streams.size(); ++ident) {
+        if (cfg.streams[ident].latency >= 0) {
+            mq.add_stream(ident, seconds(cfg.streams[ident].latency));
+        }
+    }
+
+    std::vector<int64_t> waits;
+    waits.reserve(arrivals.size());
+    std::vector<node_t> got;
+    auto drain = [&](const timepoint_t& now) {
+        got.clear();
+        mq.drain_prompt(std::back_inserter(got), now);
+        for (const auto& node : got) {
+            waits.push_back((now - node.debut).count());
+        }
+    };
+
+    const auto period = seconds(cfg.drain_period);
+    timepoint_t next_drain = timepoint_t(period);
+    for (const auto& arr : arrivals) {
+        if (period > duration_t::zero()) {
+            while (next_drain <= arr.when) {
+                drain(next_drain);
+                next_drain += period;
+            }
+        }
+        ++res.fed;
+        if (!mq.feed(arr.ordering, arr.ordering, arr.ident, arr.when)) {
+            ++res.lost;
+        }
+        if (period == duration_t::zero()) {
+            drain(arr.when);
+        }
+    }
+    drain(timepoint_t(seconds(cfg.duration)));
+
+    res.drained = waits.size();
+    res.left = mq.size();
+    for (size_t ident = 0; ident < cfg.streams.size(); ++ident) {
+        res.stale += mq.stats(ident).stale;
+    }
+    res.p50 = quantile(waits, 0.50);
+    res.p90 = quantile(waits, 0.90);
+    res.p99 = quantile(waits, 0.99);
+    res.pmax = quantile(waits, 1.0);
+    const auto t1 = std::chrono::steady_clock::now();
+    res.wall = std::chrono::duration<double>(t1-t0).count();
+    return res;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::cerr << "usage: simzip config.json" << std::endl;
+        return 1;
+    }
+    std::ifstream fin(argv[1]);
+    if (!fin) {
+        std::cerr << "simzip: can not read " << argv[1] << std::endl;
+        return 1;
+    }
+    Config cfg;
+    try {
+        cfg = parse(json::parse(fin));
+    }
+    catch (const json::exception& err) {
+        std::cerr << "simzip: bad config: " << err.what() << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument& err) {
+        std::cerr << "simzip: bad config: " << err.what() << std::endl;
+        return 1;
+    }
+
+    // The same arrivals are used for every latency setting.
+    std::mt19937_64 rng(cfg.seed);
+    std::vector<Arrival> arrivals;
+    for (size_t ident = 0; ident < cfg.streams.size(); ++ident) {
+        generate(cfg.streams[ident], ident, cfg.duration, rng, arrivals);
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [](const Arrival& a, const Arrival& b) { return a.when < b.when; });
+
+    size_t nthreads = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+    nthreads = std::max<size_t>(1, std::min(nthreads, cfg.latencies.size()));
+    std::vector<Result> results(cfg.latencies.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t ith = 0; ith < nthreads; ++ith) {
+        threads.emplace_back([&] {
+            for (size_t ind = next++; ind < results.size(); ind = next++) {
+                results[ind] = simulate(cfg, arrivals, cfg.latencies[ind]);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    std::cout << "streams=" << cfg.streams.size()
+              << " cardinality=" << cfg.cardinality
+              << " nodes=" << arrivals.size()
+              << " duration=" << cfg.duration << " s"
+              << " threads=" << nthreads << "\n";
+    std::cout << std::setprecision(3);
+    std::cout << std::setw(10) << "latency"
+              << std::setw(10) << "loss"
+              << std::setw(10) << "left"
+              << std::setw(8) << "stale"
+              << std::setw(11) << "p50"
+              << std::setw(11) << "p90"
+              << std::setw(11) << "p99"
+              << std::setw(11) << "max"
+              << std::setw(9) << "MHz" << "\n";
+    for (const auto& res : results) {
+        std::cout << std::setw(10) << res.latency
+                  << std::setw(10) << std::scientific << (res.fed ? double(res.lost)/res.fed : 0)
+                  << std::defaultfloat << std::setw(10) << res.left
+                  << std::setw(8) << res.stale
+                  << std::setw(11) << res.p50
+                  << std::setw(11) << res.p90
+                  << std::setw(11) << res.p99
+                  << std::setw(11) << res.pmax
+                  << std::setw(9) << res.fed/res.wall*1e-6 << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Compare the cost of the merge with different clocks.
+//
+// A scalar payload is used so that reading the clock is a noticeable
+// part of the per-node cost.  Each "batch" is one node per stream.
+
+#include "zipper.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+
+const int nstreams = 10;
+const int nsend = 10000000;
+
+// Per node timestamping: feed() and drain_prompt() each read the clock.
+template<typename Clock>
+double per_node()
+{
+    using node_t = zipper::Node<size_t, size_t, size_t, typename Clock::time_point>;
+    using merge_t = zipper::merge<node_t>;
+    merge_t zm(nstreams, std::chrono::microseconds(1000));
+
+    std::vector<node_t> got;
+    got.reserve(2*nstreams);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int count = 0; count < nsend; ++count) {
+        const size_t ident = count % nstreams;
+        zm.feed(count, count, ident);
+        got.clear();
+        zm.drain_prompt(std::back_inserter(got));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+}
+
+// Batched timestamping: one clock reading per batch.
+template<typename Clock>
+double per_batch()
+{
+    using node_t = zipper::Node<size_t, size_t, size_t, typename Clock::time_point>;
+    using merge_t = zipper::merge<node_t>;
+    merge_t zm(nstreams, std::chrono::microseconds(1000));
+
+    std::vector<node_t> batch(nstreams);
+    std::vector<node_t> got;
+    got.reserve(2*nstreams);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int count = 0; count < nsend; count += nstreams) {
+        for (int ind=0; ind<nstreams; ++ind) {
+            batch[ind].payload = batch[ind].ordering = count + ind;
+            batch[ind].identity = ind;
+        }
+        const auto now = Clock::now();
+        zm.feed_batch(batch.begin(), batch.end(), now);
+        got.clear();
+        zm.drain_prompt(std::back_inserter(got), now);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+}
+
+void report(const std::string& name, double us)
+{
+    std::cerr << name << ": " << us*1e-6 << " s, " << nsend/us << " MHz" << std::endl;
+}
+
+int main()
+{
+    using coarse_t = zipper::coarse_clock<>;
+    using tsc_t = zipper::tsc_clock<>;
+    tsc_t::calibrate();
+    coarse_t::tick();
+
+    std::cerr << "Nstream=" << nstreams << ", Nsend=" << nsend*1e-6 << " M" << std::endl;
+    report("steady per node ", per_node<std::chrono::steady_clock>());
+    report("tsc    per node ", per_node<tsc_t>());
+    report("coarse per node ", per_node<coarse_t>());
+    report("logical per node", per_node<zipper::logical_clock>());
+    report("steady per batch", per_batch<std::chrono::steady_clock>());
+    report("tsc    per batch", per_batch<tsc_t>());
+    return 0;
+}
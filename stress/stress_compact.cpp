@@ -0,0 +1,65 @@
+// Compare full and compact nodes with a deep queue.
+//
+// As in stress_radix, many streams are fed in a round robin and once
+// the queue is deep half of it is popped with next().  The queue is
+// made deep enough to fall out of cache.
+
+#include "zipper.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <random>
+
+const int nstreams = 1000;
+const int nsend = 20000000;
+const size_t depth = 1000000;
+
+template<typename Merge>
+double run()
+{
+    using node_t = typename Merge::node_t;
+    using traits_t = typename Merge::traits_t;
+    Merge zm(nstreams);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> step(1, 100);
+    std::vector<uint32_t> last(nstreams, 0);
+
+    std::chrono::nanoseconds zmdt{0};
+    const typename Merge::timepoint_t debut{};
+    for (int count = 0; count < nsend; ++count) {
+        const size_t ident = count % nstreams;
+        last[ident] += step(rng);
+        auto ta = std::chrono::steady_clock::now();
+        zm.feed(traits_t::make(count, last[ident], ident, debut));
+        if (zm.size() > depth) {
+            while (zm.size() > depth/2) {
+                zm.next();
+            }
+        }
+        auto tb = std::chrono::steady_clock::now();
+        zmdt += tb-ta;
+    }
+    std::cerr << "sizeof(node)=" << sizeof(node_t) << " ";
+    return std::chrono::duration_cast<std::chrono::microseconds>(zmdt).count();
+}
+
+void report(const std::string& name, double us)
+{
+    std::cerr << name << ": " << us*1e-6 << " s, " << nsend/us << " MHz" << std::endl;
+}
+
+int main()
+{
+    using node_t = zipper::Node<uint32_t>;
+    using compact_t = zipper::CompactNode<uint32_t>;
+    std::cerr << "Nstream=" << nstreams
+              << ", Nsend=" << nsend*1e-6 << " M"
+              << ", depth=" << depth << std::endl;
+    report("node    heap ", run<zipper::merge<node_t>>());
+    report("compact heap ", run<zipper::merge<compact_t>>());
+    report("node    radix", run<zipper::merge<node_t, zipper::radix_queue<node_t>>>());
+    report("compact radix", run<zipper::merge<compact_t, zipper::radix_queue<compact_t>>>());
+    return 0;
+}
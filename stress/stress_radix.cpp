@@ -0,0 +1,63 @@
+// Compare heap and radix queue backends with a deep queue.
+//
+// Many streams are fed in a round robin.  Once the queue is deep,
+// half of it is popped with next().  A scalar payload and not
+// checking completeness isolates the queue cost.
+
+#include "zipper.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <random>
+
+const int nstreams = 1000;
+const int nsend = 20000000;
+const size_t depth = 100000;
+
+template<typename Merge>
+double run()
+{
+    using node_t = typename Merge::node_t;
+    Merge zm(nstreams);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> step(1, 100);
+    std::vector<size_t> last(nstreams, 0);
+
+    size_t ndrained = 0;
+    std::chrono::nanoseconds zmdt{0};
+    const typename node_t::timepoint_t debut{};
+    for (int count = 0; count < nsend; ++count) {
+        const size_t ident = count % nstreams;
+        last[ident] += step(rng);
+        auto ta = std::chrono::steady_clock::now();
+        zm.feed(node_t{(size_t)count, last[ident], ident, debut});
+        if (zm.size() > depth) {
+            while (zm.size() > depth/2) {
+                zm.next();
+                ++ndrained;
+            }
+        }
+        auto tb = std::chrono::steady_clock::now();
+        zmdt += tb-ta;
+    }
+    std::cerr << "drained " << ndrained << ", left " << zm.size() << std::endl;
+    return std::chrono::duration_cast<std::chrono::microseconds>(zmdt).count();
+}
+
+void report(const std::string& name, double us)
+{
+    std::cerr << name << ": " << us*1e-6 << " s, " << nsend/us << " MHz" << std::endl;
+}
+
+int main()
+{
+    using node_t = zipper::Node<size_t>;
+    std::cerr << "Nstream=" << nstreams
+              << ", Nsend=" << nsend*1e-6 << " M"
+              << ", depth=" << depth << std::endl;
+    report("heap ", run<zipper::merge<node_t>>());
+    report("radix", run<zipper::merge<node_t, zipper::radix_queue<node_t>>>());
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Compare a thread per merge with merges sharing a scheduler pool.
+//
+// Many merges with a latency bound are fed in sparse bursts by a few
+// producer threads.  With a thread per merge each thread waits on its
+// own inbox and wakes to its merge deadline.  With the scheduler a
+// small pool runs merges only when fed or due.  Reported is the time
+// to deliver or reject every node and the context switches taken.
+
+#include "zipper.hpp"
+#include "zipper/scheduler.hpp"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using node_t = zipper::Node<size_t>;
+using merge_t = zipper::merge<node_t>;
+using scheduler_t = zipper::scheduler<merge_t>;
+
+const size_t nmerges = 200;
+const size_t nstreams = 4;
+const size_t nbursts = 200;
+const size_t burst = 10;
+const auto latency = std::chrono::milliseconds(50);
+const size_t nsend = nmerges*nstreams*nbursts*burst;
+
+// Feed all merges from one thread per stream.
+template<typename Feed>
+void produce(Feed feed)
+{
+    std::vector<std::thread> producers;
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        producers.emplace_back([&, ident] {
+            size_t ord = 0;
+            for (size_t ib = 0; ib < nbursts; ++ib) {
+                for (size_t id = 0; id < nmerges; ++id) {
+                    for (size_t ind = 0; ind < burst; ++ind) {
+                        const size_t o = (ord + ind)*nstreams + ident;
+                        feed(id, node_t{o, o, ident, merge_t::clock_t::now()});
+                    }
+                }
+                ord += burst;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+    }
+    for (auto& th : producers) {
+        th.join();
+    }
+}
+
+long switches()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+void report(const std::string& name, std::chrono::steady_clock::time_point t0, long cs0,
+            size_t rejected)
+{
+    const double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << name << ": " << dt << " s, " << nsend/dt*1e-6 << " MHz, "
+              << switches() - cs0 << " context switches, "
+              << rejected << " rejected" << std::endl;
+}
+
+struct Dedicated {
+    merge_t mq{nstreams, latency};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<node_t> inbox;
+};
+
+void run_threads(std::atomic<size_t>& delivered, std::atomic<size_t>& rejected)
+{
+    std::vector<Dedicated> ded(nmerges);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < nmerges; ++id) {
+        threads.emplace_back([&, id] {
+            auto& d = ded[id];
+            std::vector<node_t> work, out;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lk(d.mutex);
+                    auto when = d.mq.deadline();
+                    auto ready = [&] { return done || !d.inbox.empty(); };
+                    if (when == merge_t::timepoint_t::max()) {
+                        d.cv.wait(lk, ready);
+                    }
+                    else {
+                        d.cv.wait_until(lk, when, ready);
+                    }
+                    std::swap(work, d.inbox);
+                }
+                for (const auto& node : work) {
+                    if (!d.mq.feed(node)) {
+                        ++rejected;
+                    }
+                }
+                work.clear();
+                out.clear();
+                d.mq.drain_prompt(std::back_inserter(out));
+                delivered += out.size();
+                if (done && d.mq.empty()) {
+                    return;
+                }
+            }
+        });
+    }
+    produce([&](size_t id, const node_t& node) {
+        auto& d = ded[id];
+        {
+            std::lock_guard<std::mutex> lk(d.mutex);
+            d.inbox.push_back(node);
+        }
+        d.cv.notify_one();
+    });
+    while (delivered + rejected < nsend) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done = true;
+    for (auto& d : ded) {
+        { std::lock_guard<std::mutex> lk(d.mutex); }
+        d.cv.notify_one();
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+}
+
+void run_scheduler(std::atomic<size_t>& delivered, std::atomic<size_t>& rejected,
+                   size_t nthreads)
+{
+    scheduler_t sched;
+    for (size_t id = 0; id < nmerges; ++id) {
+        sched.add(nstreams, latency, [&](size_t, const std::vector<node_t>& nodes) {
+            delivered += nodes.size();
+        });
+    }
+    sched.start(nthreads);
+    produce([&](size_t id, const node_t& node) { sched.feed(id, node); });
+    while (true) {
+        rejected = 0;
+        for (size_t id = 0; id < nmerges; ++id) {
+            rejected += sched.stats(id).rejected;
+        }
+        if (delivered + rejected >= nsend) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main()
+{
+    const size_t nthreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cerr << "Nmerges=" << nmerges << ", Nstreams=" << nstreams
+              << ", Nsend=" << nsend*1e-6 << " M"
+              << ", pool=" << nthreads << std::endl;
+    {
+        std::atomic<size_t> delivered{0}, rejected{0};
+        auto t0 = std::chrono::steady_clock::now();
+        auto cs0 = switches();
+        run_threads(delivered, rejected);
+        report("thread per merge", t0, cs0, rejected);
+    }
+    {
+        std::atomic<size_t> delivered{0}, rejected{0};
+        auto t0 = std::chrono::steady_clock::now();
+        auto cs0 = switches();
+        run_scheduler(delivered, rejected, nthreads);
+        report("scheduler       ", t0, cs0, rejected);
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Compare merging streams fed in-process with streams fed through
+// shared memory rings by separate producer processes.
+//
+// Producers are this same program exec'd with "produce" arguments.
+
+#include "zipper/shm.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cassert>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// mock of a fixed size readout record
+struct Payload {
+    size_t ident, count;
+    int adc[12];
+};
+
+const size_t nstreams = 4;
+const size_t nsend = 1000000;   // per stream
+const size_t capacity = 4096;
+
+using shm_node_t = zipper::Node<const Payload*>;
+using shm_merge_t = zipper::merge<shm_node_t>;
+using source_t = zipper::shm_source<shm_merge_t>;
+using ring_t = source_t::ring_t;
+
+int produce(const char* name, size_t ident)
+{
+    auto ring = ring_t::open(name);
+    for (size_t count = 0; count < nsend; ++count) {
+        ring_t::slot_t* slot = nullptr;
+        while (!(slot = ring.claim())) {
+            ::usleep(1);
+        }
+        slot->ordering = count*nstreams + ident;
+        slot->payload.ident = ident;
+        slot->payload.count = count;
+        ring.publish();
+    }
+    return 0;
+}
+
+// Payloads are made and copied into the merge in this process.
+double inproc()
+{
+    using node_t = zipper::Node<Payload>;
+    zipper::merge<node_t> zm(nstreams);
+    std::vector<node_t> got;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t count = 0; count < nsend; ++count) {
+        for (size_t ident = 0; ident < nstreams; ++ident) {
+            Payload pay{ident, count, {}};
+            zm.feed(pay, count*nstreams + ident, ident);
+        }
+        got.clear();
+        zm.drain_waiting(std::back_inserter(got));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+}
+
+// Payloads are made by other processes and read in place.
+double shm(const char* self)
+{
+    shm_merge_t zm(nstreams);
+    source_t src;
+    std::vector<std::string> names;
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        names.push_back("/zipper-stress-" + std::to_string(::getpid())
+                        + "-" + std::to_string(ident));
+        src.add(ident, ring_t::create(names.back(), capacity));
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            const std::string sident = std::to_string(ident);
+            ::execl(self, self, "produce", names[ident].c_str(), sident.c_str(),
+                    (char*)nullptr);
+            ::_exit(1);
+        }
+        pids.push_back(pid);
+    }
+
+    std::vector<shm_node_t> got;
+    size_t ngot = 0;
+    while (ngot + nstreams < nsend*nstreams) {
+        if (!src.poll(zm)) {
+            ::usleep(1);
+        }
+        got.clear();
+        zm.drain_waiting(std::back_inserter(got));
+        for (const auto& node : got) {
+            src.release(node);
+        }
+        ngot += got.size();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    for (auto pid : pids) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+    }
+    for (const auto& name : names) {
+        ring_t::unlink(name);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+}
+
+void report(const std::string& name, double us)
+{
+    const double ntot = nsend*nstreams;
+    std::cerr << name << ": " << us*1e-6 << " s, " << ntot/us << " MHz" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 4 && std::strcmp(argv[1], "produce") == 0) {
+        return produce(argv[2], std::stoul(argv[3]));
+    }
+    std::cerr << "Nstream=" << nstreams
+              << ", Nsend=" << nstreams*nsend*1e-6 << " M"
+              << ", sizeof(Payload)=" << sizeof(Payload) << std::endl;
+    report("inproc", inproc());
+    report("shm   ", shm(argv[0]));
+    return 0;
+}
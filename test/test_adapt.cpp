@@ -0,0 +1,105 @@
+// Test adapting stream latency budgets to observed arrival gaps.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+using node_t = zipper::Node<size_t>;
+using merge_t = zipper::merge<node_t>;
+using std::chrono::microseconds;
+
+merge_t::timepoint_t us(double micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::duration_cast<merge_t::duration_t>(
+        std::chrono::duration<double, std::micro>(micros));
+    return ret;
+}
+
+void test_p2()
+{
+    std::mt19937 rng(1);
+    std::exponential_distribution<double> expo(1.0);
+    zipper::p2_quantile q99(0.99), q50(0.5);
+    assert(q50.value() == 0);
+    std::vector<double> xs;
+    for (int ind = 0; ind < 100000; ++ind) {
+        const double x = expo(rng);
+        xs.push_back(x);
+        q99.add(x);
+        q50.add(x);
+    }
+    // exact: -ln(1-p)
+    assert(std::abs(q50.value() - std::log(2.0)) < 0.02);
+    assert(std::abs(q99.value() - std::log(100.0)) < 0.1);
+    assert(q99.count() == xs.size());
+
+    zipper::p2_quantile few(0.5);
+    few.add(3);
+    few.add(1);
+    few.add(2);
+    assert(few.value() == 2);
+}
+
+void test_merge()
+{
+    merge_t mq(3, microseconds(5));
+
+    bool threw = false;
+    try {
+        mq.adapt_latency(0, microseconds(1), microseconds(100));
+    }
+    catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    mq.add_stream(2, microseconds(7)); // fixed
+    mq.adapt_latency(0.01, microseconds(2), microseconds(100));
+
+    // stream 0 arrives every 1us, stream 1 every 10us with jitter
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> jitter(0, 2);
+    std::vector<node_t> got;
+    size_t ord = 0;
+    for (int tick = 0; tick < 20000; ++tick) {
+        mq.feed(ord, ord, 0, us(tick));
+        ++ord;
+        if (tick % 10 == 0) {
+            mq.feed(ord, ord, 1, us(tick + jitter(rng)));
+            ++ord;
+        }
+        if (tick % 5 == 0) {
+            mq.feed(ord, ord, 2, us(tick));
+            ++ord;
+        }
+        mq.drain_prompt(std::back_inserter(got), us(tick));
+    }
+
+    // floored at lo
+    assert(mq.effective_latency(0) == microseconds(2));
+    // near the largest gap of 12us, well under hi
+    auto l1 = mq.effective_latency(1);
+    assert(l1 > microseconds(9));
+    assert(l1 <= microseconds(12));
+    assert(mq.stats(1).latency == l1);
+    // registered budget is kept
+    assert(mq.effective_latency(2) == microseconds(7));
+
+    // a new stream starts at the upper bound
+    mq.feed(ord, ord, 3, us(20000));
+    assert(mq.effective_latency(3) == microseconds(100));
+}
+
+int main()
+{
+    test_p2();
+    test_merge();
+    std::cerr << "test_adapt: pass\n";
+    return 0;
+}
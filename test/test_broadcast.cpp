@@ -0,0 +1,143 @@
+// Test fan out of merged output to several consumers.
+
+#include "zipper.hpp"
+#include "zipper/broadcast.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using node_t = zipper::Node<size_t>;
+using merge_t = zipper::merge<node_t>;
+using broadcast_t = zipper::broadcast<node_t>;
+
+// Merge three streams into a blocking broadcast read by three threads.
+void test_block()
+{
+    const size_t nconsumers = 3;
+    const size_t nstreams = 3;
+    const size_t nsend = 30000 * nstreams;
+    broadcast_t bc(64, nconsumers);
+    assert(bc.capacity() == 64);
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> counts(nconsumers, 0);
+    for (size_t which=0; which<nconsumers; ++which) {
+        threads.emplace_back([&, which] {
+            size_t last = 0;
+            size_t& count = counts[which];
+            while (count < nsend) {
+                auto num = bc.consume(which, [&](const node_t& node) {
+                    assert(node.ordering >= last);
+                    last = node.ordering;
+                    ++count;
+                });
+                if (!num) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    merge_t mq(nstreams);
+    for (size_t ord=0; ord < nsend/nstreams; ++ord) {
+        for (size_t ident=0; ident<nstreams; ++ident) {
+            mq.feed(ord, ord, ident);
+        }
+        mq.drain_waiting(bc.inserter());
+    }
+    mq.drain_full(bc.inserter());
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (size_t which=0; which<nconsumers; ++which) {
+        assert(counts[which] == nsend);
+        auto st = bc.stats(which);
+        assert(st.lag == 0);
+        assert(st.consumed == nsend);
+        assert(st.dropped == 0);
+    }
+    std::cerr << "test_block: pass\n";
+}
+
+void test_backpressure()
+{
+    broadcast_t bc(4, 2);
+    for (size_t ind=0; ind<4; ++ind) {
+        assert(bc.push(node_t{ind, ind, 0, {}}));
+    }
+    assert(!bc.push(node_t{4, 4, 0, {}})); // both consumers are behind
+    node_t node;
+    assert(bc.pop(0, node));
+    assert(node.ordering == 0);
+    assert(!bc.push(node_t{4, 4, 0, {}})); // consumer 1 is behind
+    assert(bc.stats(1).lag == 4);
+    assert(bc.pop(1, node));
+    assert(bc.push(node_t{4, 4, 0, {}}));
+    assert(bc.stats(0).lag == 4);
+    std::cerr << "test_backpressure: pass\n";
+}
+
+void test_drop()
+{
+    broadcast_t bc(4, 2, broadcast_t::policy::drop);
+    for (size_t ind=0; ind<10; ++ind) {
+        assert(bc.push(node_t{ind, ind, 0, {}}));
+        if (ind < 8) {          // consumer 0 keeps up for a while
+            node_t node;
+            assert(bc.pop(0, node));
+            assert(node.ordering == ind);
+        }
+    }
+    auto st0 = bc.stats(0);
+    assert(st0.lag == 2 && st0.consumed == 8 && st0.dropped == 0);
+    auto st1 = bc.stats(1);
+    assert(st1.lag == 4 && st1.consumed == 0 && st1.dropped == 6);
+
+    std::vector<size_t> got;
+    bc.consume(1, [&](const node_t& n) { got.push_back(n.ordering); });
+    assert((got == std::vector<size_t>{6, 7, 8, 9}));
+    std::cerr << "test_drop: pass\n";
+}
+
+// A slow consumer under drop policy must not see torn values nor
+// stall the producer, down to a single slot.
+void test_drop_threads(size_t capacity)
+{
+    using vec_t = std::vector<size_t>;
+    zipper::broadcast<vec_t> bc(capacity, 1, zipper::broadcast<vec_t>::policy::drop);
+    const size_t nsend = 200000;
+    std::thread reader([&] {
+        size_t seen = 0;
+        while (seen + bc.stats(0).dropped < nsend) {
+            auto num = bc.consume(0, [](const vec_t& v) {
+                for (auto x : v) {
+                    assert(x == v[0]);
+                }
+            });
+            if (!num) {
+                std::this_thread::yield();
+            }
+            seen += num;
+        }
+    });
+    for (size_t ind=0; ind<nsend; ++ind) {
+        bc.push(vec_t(16, ind));
+    }
+    reader.join();
+    auto st = bc.stats(0);
+    assert(st.consumed + st.dropped + st.lag == nsend);
+    std::cerr << "test_drop_threads(" << capacity << "): pass, dropped "
+              << st.dropped << "\n";
+}
+
+int main()
+{
+    test_block();
+    test_backpressure();
+    test_drop();
+    test_drop_threads(8);
+    test_drop_threads(1);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Test per-stream latency budgets.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+using node_t = zipper::Node<int>;
+using merge_t = zipper::merge<node_t>;
+
+merge_t::timepoint_t us(int micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+size_t drain(merge_t& mq, int time)
+{
+    std::vector<node_t> got;
+    mq.drain_prompt(std::back_inserter(got), us(time));
+    return got.size();
+}
+
+void test_budgets()
+{
+    // slow stream 2 gets a larger budget than the default
+    merge_t mq(3, std::chrono::microseconds(10));
+    mq.add_stream(2, std::chrono::microseconds(100));
+    assert(mq.stats(2).latency == std::chrono::microseconds(100));
+    assert(mq.deadline() == merge_t::timepoint_t::max()); // empty
+
+    mq.feed(100, 100, 2, us(0));   // the slow one's next node
+    for (int t=1; t<=5; ++t) {
+        mq.feed(t, t, 0, us(t));
+    }
+    for (int t=1; t<=2; ++t) {  // and stream 1 hiccups
+        mq.feed(t, t, 1, us(t));
+    }
+    assert(mq.stats(0).latency == std::chrono::microseconds(10));
+    assert(drain(mq, 5) == 3);
+    assert(mq.deadline() == us(12)); // stream 1 goes stale soon
+    assert(drain(mq, 11) == 0);
+    assert(drain(mq, 12) == 3);
+    assert(mq.stats(1).stale == 1);
+    assert(mq.stats(0).stale == 0);
+
+    // then all fast ones are stale and only the slow one is left
+    assert(drain(mq, 15) == 1);
+    assert(mq.size() == 1);
+    assert(mq.deadline() == us(100));
+    assert(drain(mq, 99) == 0);
+    assert(drain(mq, 100) == 1);
+    assert(mq.stats(0).stale == 1);
+    assert(mq.stats(1).stale == 1); // still the same episode
+    assert(mq.stats(2).stale == 0); // its own node was drained
+
+    // Change budget of unrepresented stream to unbound.
+    mq.add_stream(2, merge_t::duration_t::zero());
+    mq.feed(101, 101, 0, us(111));
+    mq.feed(102, 102, 0, us(112));
+    assert(mq.deadline() == merge_t::timepoint_t::max());
+    assert(drain(mq, 1000000) == 0);
+    std::cerr << "test_budgets: pass\n";
+}
+
+void test_registered_absent()
+{
+    merge_t mq(2);              // unbound latency by default
+    mq.add_stream(1, std::chrono::microseconds(10));
+    mq.feed(0, 0, 0, us(0));
+    mq.feed(1, 1, 0, us(1));
+    // stream 1 is absent but has a latency bound so does not block
+    assert(mq.complete());
+    assert(drain(mq, 0) == 1);
+
+    mq.add_stream(2, merge_t::duration_t::zero());
+    mq.set_cardinality(3);
+    mq.feed(2, 2, 0, us(2));
+    // stream 2 is absent with unbound latency
+    assert(!mq.complete(us(1000)));
+    std::cerr << "test_registered_absent: pass\n";
+}
+
+void test_many()
+{
+    const size_t nstreams = 5000;
+    merge_t mq(nstreams, std::chrono::microseconds(10));
+    for (size_t ident=0; ident<nstreams; ++ident) {
+        mq.add_stream(ident, std::chrono::microseconds(10 + ident));
+        mq.feed(ident, ident, ident, us(0));
+    }
+    // each node waits only on its own stream going stale
+    assert(drain(mq, 0) == 0);
+    assert(mq.deadline() == us(10));
+    assert(drain(mq, 10) == 1);
+    assert(mq.deadline() == us(11));
+    assert(drain(mq, 10 + nstreams - 2) == nstreams - 2);
+    assert(mq.deadline() == us(10 + nstreams - 1));
+    assert(drain(mq, 10 + nstreams - 1) == 1);
+    assert(mq.empty());
+    std::cerr << "test_many: pass\n";
+}
+
+int main()
+{
+    test_budgets();
+    test_registered_absent();
+    test_many();
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Exercise the merge with the provided clocks.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+template<typename Clock>
+using node_tt = zipper::Node<int, size_t, size_t, typename Clock::time_point>;
+
+// The logical clock drives latency just like a real clock.
+void test_logical()
+{
+    using clock_t = zipper::logical_clock;
+    using merge_t = zipper::merge<node_tt<clock_t>>;
+
+    clock_t::set(clock_t::time_point{});
+    merge_t mq(2, std::chrono::microseconds(10));
+
+    // debut defaults to the logical "now"
+    assert(mq.feed(1, 1, 1));
+    assert(mq.feed(2, 2, 1));
+    assert(mq.peek().debut == clock_t::time_point{});
+
+    std::vector<merge_t::node_t> got;
+    clock_t::advance(std::chrono::microseconds(5));
+    mq.drain_prompt(std::back_inserter(got));
+    assert(got.size() == 1);    // 1 is waiting on no one
+    assert(got[0].payload == 1);
+
+    clock_t::advance(std::chrono::microseconds(5));
+    assert(mq.feed(3, 3, 2));
+    mq.drain_prompt(std::back_inserter(got));
+    assert(got.size() == 2);    // stream 1 is now stale
+    assert(got[1].payload == 2);
+
+    clock_t::advance(std::chrono::microseconds(5));
+    mq.drain_prompt(std::back_inserter(got));
+    assert(got.size() == 2);    // stream 2 is not yet stale
+
+    clock_t::advance(std::chrono::microseconds(5));
+    mq.drain_prompt(std::back_inserter(got));
+    assert(got.size() == 3);
+    assert(got[2].payload == 3);
+    std::cerr << "logical clock: pass\n";
+}
+
+// The coarse clock only changes on tick().
+void test_coarse()
+{
+    using clock_t = zipper::coarse_clock<>;
+    using merge_t = zipper::merge<node_tt<clock_t>>;
+
+    const auto t0 = clock_t::tick();
+    assert(clock_t::now() == t0);
+
+    merge_t mq(1);
+    std::vector<merge_t::node_t> batch;
+    for (int ind=0; ind<10; ++ind) {
+        batch.push_back(merge_t::node_t{ind, (size_t)ind, 0, {}});
+    }
+    auto nacc = mq.feed_batch(batch.begin(), batch.end());
+    assert(nacc == batch.size());
+    assert(mq.peek().debut == t0);
+
+    const auto t1 = clock_t::tick();
+    assert(t1 >= t0);
+    std::cerr << "coarse clock: pass\n";
+}
+
+// The TSC clock tracks the steady clock.
+void test_tsc()
+{
+    using clock_t = zipper::tsc_clock<>;
+    clock_t::calibrate();
+
+    const auto t0 = clock_t::now();
+    const auto s0 = std::chrono::steady_clock::now();
+    auto s1 = s0;
+    while (s1 - s0 < std::chrono::milliseconds(20)) {
+        s1 = std::chrono::steady_clock::now();
+    }
+    const auto t1 = clock_t::now();
+    const auto dt = t1 - t0;
+    const auto ds = s1 - s0;
+    std::cerr << "tsc: " << dt.count() << " ns, steady: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(ds).count()
+              << " ns\n";
+    assert(dt > ds/2 && dt < ds*2);
+    std::cerr << "tsc clock: pass\n";
+}
+
+int main()
+{
+    test_logical();
+    test_coarse();
+    test_tsc();
+    return 0;
+}
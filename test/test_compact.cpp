@@ -0,0 +1,60 @@
+// Test the merge with a compact node type.
+
+#include "zipper.hpp"
+#include "zipper/trace.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+using compact_t = zipper::CompactNode<size_t>;
+using node_t = zipper::Node<size_t>;
+
+static_assert(!zipper::node_traits<compact_t>::has_debut);
+static_assert(zipper::node_traits<node_t>::has_debut);
+static_assert(sizeof(compact_t)*2 <= sizeof(node_t));
+
+template<typename Merge>
+std::vector<size_t> run(Merge& mq)
+{
+    using cnode_t = typename Merge::node_t;
+    std::vector<cnode_t> got;
+    for (size_t ord=0; ord<100; ++ord) {
+        for (size_t ident : {2, 0, 1}) {
+            assert(mq.feed(ord*3+ident, ord*3+ident, ident));
+        }
+        mq.drain_waiting(std::back_inserter(got));
+    }
+    assert(got.size() == 99*3);
+    mq.drain_full(std::back_inserter(got));
+    std::vector<size_t> pays;
+    for (const auto& node : got) {
+        pays.push_back(node.payload);
+    }
+    return pays;
+}
+
+int main()
+{
+    zipper::merge<node_t> mq(3);
+    zipper::merge<compact_t> cmq(3);
+    zipper::merge<compact_t, zipper::radix_queue<compact_t>, zipper::ring_trace<>> rmq(3);
+    auto want = run(mq);
+    assert(run(cmq) == want);
+    assert(run(rmq) == want);
+
+    // debut may be given but is ignored
+    assert(cmq.feed(0, 1000, 0, zipper::merge<compact_t>::clock_t::now()));
+
+    bool caught = false;
+    try {
+        zipper::merge<compact_t> lossy(3, std::chrono::seconds(1));
+    }
+    catch (const std::invalid_argument& err) {
+        caught = true;
+    }
+    assert(caught);
+    std::cerr << "test_compact: pass, sizes " << sizeof(compact_t)
+              << " vs " << sizeof(node_t) << "\n";
+    return 0;
+}
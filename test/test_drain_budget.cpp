@@ -0,0 +1,68 @@
+// Test count and deadline budgeted drains.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+using clock_t_ = zipper::logical_clock;
+using node_t = zipper::Node<size_t, size_t, size_t, clock_t_::time_point>;
+using merge_t = zipper::merge<node_t>;
+
+int main()
+{
+    const size_t nstreams = 2;
+    merge_t mq(nstreams, std::chrono::microseconds(10));
+    std::vector<node_t> got;
+
+    for (size_t ord = 0; ord < 1000; ++ord) {
+        mq.feed(ord, ord, ord % nstreams, clock_t_::now());
+    }
+
+    // count budget, resumes where it left off
+    merge_t::drain_budget budget;
+    budget.most = 100;
+    auto res = mq.drain_waiting(std::back_inserter(got), budget);
+    assert(res.count == 100);
+    assert(res.more);
+    assert(got.size() == 100);
+    res = mq.drain_waiting(res.result, budget);
+    assert(res.count == 100);
+    assert(res.more);
+    assert(got.size() == 200);
+    for (size_t ind = 0; ind < got.size(); ++ind) {
+        assert(got[ind].ordering == ind);
+    }
+
+    // an ample budget drains all that is complete
+    budget.most = 10000;
+    res = mq.drain_waiting(std::back_inserter(got), budget);
+    assert(!res.more);
+    assert(got.size() == 998);  // the top node does not count
+    assert(!mq.complete());
+
+    // deadline budget is checked every so many nodes
+    for (size_t ord = 1000; ord < 2000; ++ord) {
+        mq.feed(ord, ord, ord % nstreams, clock_t_::now());
+    }
+    got.clear();
+    budget = merge_t::drain_budget{};
+    budget.until = clock_t_::now();
+    auto now = clock_t_::now();
+    auto pres = mq.drain_prompt(std::back_inserter(got), now, budget);
+    assert(pres.more);
+    assert(pres.count == merge_t::budget_check_period);
+
+    // a stale stream lets a budgeted prompt drain finish
+    clock_t_::advance(std::chrono::microseconds(100));
+    now = clock_t_::now();
+    budget = merge_t::drain_budget{};
+    pres = mq.drain_prompt(std::back_inserter(got), now, budget);
+    assert(!pres.more);
+    assert(mq.empty());
+    assert(got.size() == 2 + 1000); // left over and new
+
+    std::cerr << "test_drain_budget: pass\n";
+    return 0;
+}
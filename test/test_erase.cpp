@@ -0,0 +1,102 @@
+// Test bulk erasure of queued nodes with heap and radix queues.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+using node_t = zipper::Node<size_t>;
+
+template <typename Merge>
+std::vector<size_t> orderings(Merge& mq)
+{
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    std::vector<size_t> ret;
+    for (const auto& node : got) {
+        ret.push_back(node.ordering);
+    }
+    return ret;
+}
+
+template <typename Queue>
+void test_erase(const char* name)
+{
+    using merge_t = zipper::merge<node_t, Queue>;
+    const size_t nstreams = 3;
+    merge_t mq(nstreams);
+
+    auto fill = [&]() {
+        for (size_t ord = 0; ord < 30; ++ord) {
+            mq.feed(ord, ord, ord % nstreams);
+        }
+    };
+
+    // erase by predicate
+    fill();
+    assert(mq.erase_if([](const node_t& n) { return n.ordering % 2; }) == 15);
+    assert(mq.size() == 15);
+    assert(mq.top().ordering == 0);
+    {
+        auto got = orderings(mq);
+        assert(got.size() == 15);
+        for (size_t ind = 0; ind < got.size(); ++ind) {
+            assert(got[ind] == 2*ind);
+        }
+    }
+
+    // erase before, origin is not changed
+    mq.clear();
+    assert(mq.empty());
+    assert(mq.get_origin() == 0);
+    fill();
+    assert(mq.erase_before(10) == 10);
+    assert(mq.get_origin() == 0);
+    assert(mq.top().ordering == 10);
+    assert(mq.erase_before(10) == 0);
+    assert(mq.complete());
+
+    // erase a stream, it becomes unrepresented
+    assert(mq.erase_stream(1) == 7);
+    assert(mq.stats(1).occupancy == 0);
+    assert(mq.stats(0).occupancy == 6);
+    assert(!mq.complete());
+    assert(mq.erase_stream(1) == 0);
+    assert(mq.erase_stream(42) == 0);
+    mq.feed(31, 31, 1);
+    assert(mq.complete());
+    assert(mq.top().ordering == 11);
+    {
+        auto got = orderings(mq);
+        assert(got.size() == 13 + 1);
+        assert(got.back() == 31);
+        for (auto ord : got) {
+            assert(ord == 31 || ord % nstreams != 1);
+        }
+    }
+
+    // clear unrepresents every stream
+    fill();
+    mq.clear();
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        assert(mq.stats(ident).occupancy == 0);
+    }
+    mq.feed(1, 1, 0);
+    mq.feed(2, 2, 1);
+    assert(!mq.complete());
+    mq.feed(3, 3, 2);
+    assert(!mq.complete());     // top node does not count
+    mq.feed(4, 4, 0);
+    assert(mq.complete());
+    assert(mq.next().ordering == 1);
+
+    std::cerr << "test_erase: " << name << " pass\n";
+}
+
+int main()
+{
+    test_erase<zipper::heap_queue<node_t>>("heap");
+    test_erase<zipper::radix_queue<node_t>>("radix");
+    return 0;
+}
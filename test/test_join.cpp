@@ -0,0 +1,130 @@
+// Test joining streams into one tuple per ordering value.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <string>
+
+using node_t = zipper::Node<std::string>;
+using merge_t = zipper::merge<node_t>;
+using join_t = zipper::join<merge_t>;
+
+merge_t::timepoint_t us(int micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+// One tuple as payloads, "-" for absent.
+struct Tuple {
+    size_t ord;
+    std::vector<std::string> pays;
+};
+
+struct Collect {
+    std::vector<Tuple>& got;
+    void operator()(size_t ord, const node_t* const* first, const node_t* const* last) {
+        Tuple t{ord, {}};
+        for (; first != last; ++first) {
+            t.pays.push_back(*first ? (*first)->payload : "-");
+        }
+        got.push_back(t);
+    }
+};
+
+void test_waiting()
+{
+    merge_t mq(3);
+    join_t jn(mq, {10, 20, 30});
+    assert(jn.arity() == 3);
+    std::vector<Tuple> got;
+    Collect collect{got};
+
+    //       pay, ord, ident
+    mq.feed("a1", 1, 10);
+    mq.feed("b1", 1, 20);
+    mq.feed("c1", 1, 30);
+    mq.feed("a2", 2, 10);
+    mq.feed("c2", 2, 30);       // 20 skips 2
+    assert(jn.drain_waiting(collect) == 0); // 20 may yet send 1
+    mq.feed("b3", 3, 20);
+    mq.feed("a3", 3, 10);
+    mq.feed("c3", 3, 30);
+    mq.feed("a3bis", 3, 10);    // second at same ordering
+    mq.feed("a4", 4, 10);
+    mq.feed("b4", 4, 20);
+    mq.feed("c4", 4, 30);
+    assert(jn.drain_waiting(collect) == 3);
+    assert(got.size() == 3);
+    assert(got[0].ord == 1);
+    assert((got[0].pays == std::vector<std::string>{"a1", "b1", "c1"}));
+    assert(got[1].ord == 2);
+    assert((got[1].pays == std::vector<std::string>{"a2", "-", "c2"}));
+    assert(got[2].ord == 3);
+    assert(got[2].pays[0].substr(0, 2) == "a3"); // either of equal ordering
+    assert(got[2].pays[1] == "b3");
+    assert(got[2].pays[2] == "c3");
+    assert(jn.unjoined() == 1);
+
+    assert(jn.drain_full(collect) == 1);
+    assert(got.size() == 4);
+    assert((got[3].pays == std::vector<std::string>{"a4", "b4", "c4"}));
+}
+
+void test_prompt()
+{
+    merge_t mq(2, std::chrono::microseconds(10));
+    join_t jn(mq, {0, 1});
+    std::vector<Tuple> got;
+    Collect collect{got};
+
+    mq.feed("a1", 1, 0, us(0));
+    mq.feed("b1", 1, 1, us(0));
+    mq.feed("a2", 2, 0, us(1));
+    mq.feed("a3", 3, 0, us(2));
+    assert(jn.drain_prompt(collect, us(5)) == 0); // b1 may be followed by 1
+    assert(jn.pending() == 1);
+
+    // stream 1 goes stale, its slots are absent
+    assert(jn.drain_prompt(collect, us(20)) == 3);
+    assert(got.size() == 3);
+    assert((got[0].pays == std::vector<std::string>{"a1", "b1"}));
+    assert((got[1].pays == std::vector<std::string>{"a2", "-"}));
+    assert((got[2].pays == std::vector<std::string>{"a3", "-"}));
+    assert(jn.pending() == 0);
+    assert(mq.empty());
+}
+
+// A stale slot is not filled by a second tuple for the same ordering.
+void test_once()
+{
+    merge_t mq(2, std::chrono::microseconds(10));
+    join_t jn(mq, {0, 1});
+    std::vector<Tuple> got;
+    Collect collect{got};
+
+    mq.feed("a5", 5, 0, us(0));
+    mq.feed("b5", 5, 1, us(0));
+    mq.feed("a6", 6, 0, us(0));
+    assert(jn.drain_prompt(collect, us(20)) == 2);
+    assert((got[1].pays == std::vector<std::string>{"a6", "-"}));
+
+    assert(!mq.feed("b6", 6, 1, us(21))); // tuple 6 was emitted
+    assert(mq.feed("b7", 7, 1, us(21)));
+    assert(jn.drain_full(collect) == 1);
+    assert(got.size() == 3);
+    assert(got[2].ord == 7);
+    assert((got[2].pays == std::vector<std::string>{"-", "b7"}));
+}
+
+int main()
+{
+    test_waiting();
+    test_prompt();
+    test_once();
+    std::cerr << "test_join: pass\n";
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Test keeping nodes rejected as tardy.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <string>
+
+using node_t = zipper::Node<std::string>;
+using merge_t = zipper::merge<node_t>;
+
+merge_t::timepoint_t us(int micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+int main()
+{
+    merge_t mq(2, std::chrono::microseconds(10));
+    std::vector<node_t> got;
+    std::vector<merge_t::late_node> late;
+
+    // unused, tardy nodes are lost as before
+    mq.feed("a10", 10, 0, us(0));
+    mq.feed("a20", 20, 0, us(0));
+    mq.drain_prompt(std::back_inserter(got), us(20));
+    assert(mq.get_origin() == 20);
+    assert(!mq.feed("b5", 5, 1, us(21)));
+    assert(mq.late_size() == 0);
+
+    mq.keep_late(2);
+    assert(!mq.feed("b15", 15, 1, us(22)));
+    assert(!mq.feed("b12", 12, 1, us(22)));
+    assert(!mq.feed("b19", 19, 1, us(22)));
+    assert(mq.late_size() == 2);
+    assert(mq.late_lost() == 1);
+    assert(mq.empty());         // the merge is untouched
+    assert(mq.feed("b21", 21, 1, us(22)));
+
+    mq.drain_late(std::back_inserter(late));
+    assert(late.size() == 2);
+    assert(late[0].node.payload == "b12");
+    assert(late[0].lateness == 8);
+    assert(late[1].node.payload == "b15");
+    assert(late[1].lateness == 5);
+    assert(mq.late_size() == 0);
+
+    assert(!mq.feed("b18", 18, 1, us(23)));
+    mq.clear();
+    assert(mq.late_size() == 0);
+    std::cerr << "test_late: pass\n";
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Test ordered lookahead over queued nodes.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+using node_t = zipper::Node<size_t>;
+
+template <typename Queue>
+void test_lookahead(const char* name)
+{
+    using merge_t = zipper::merge<node_t, Queue>;
+    const size_t nstreams = 4;
+    merge_t mq(nstreams);
+
+    assert(mq.lookahead().begin() == mq.lookahead().end());
+
+    std::mt19937 rng(42);
+    std::vector<size_t> ords;
+    for (size_t ind = 0; ind < 1000; ++ind) {
+        const size_t ident = ind % nstreams;
+        const size_t ord = (rng() % 100000)*nstreams + ident; // unique
+        ords.push_back(ord);
+        mq.feed(ind, ord, ident);
+    }
+    std::sort(ords.begin(), ords.end());
+
+    // bounded
+    std::vector<size_t> seen;
+    for (const auto& node : mq.lookahead(10)) {
+        seen.push_back(node.ordering);
+    }
+    assert(seen.size() == 10);
+    assert(std::equal(seen.begin(), seen.end(), ords.begin()));
+
+    // unbounded visits all, queue untouched
+    seen.clear();
+    for (const auto& node : mq.lookahead()) {
+        seen.push_back(node.ordering);
+    }
+    assert(seen == ords);
+    assert(mq.size() == ords.size());
+    assert(mq.get_origin() == 0);
+    assert(mq.top().ordering == ords[0]);
+
+    // drain part, radix buckets get redistributed, look again
+    for (size_t ind = 0; ind < 100; ++ind) {
+        assert(mq.next().ordering == ords[ind]);
+    }
+    seen.clear();
+    for (const auto& node : mq.lookahead(500)) {
+        seen.push_back(node.ordering);
+    }
+    assert(seen.size() == 500);
+    assert(std::equal(seen.begin(), seen.end(), ords.begin() + 100));
+
+    // a coincidence trigger: another stream within delta of the top?
+    const size_t delta = 20;
+    const auto& top = mq.top();
+    bool coincident = false;
+    for (const auto& node : mq.lookahead()) {
+        if (node.ordering > top.ordering + delta) {
+            break;
+        }
+        coincident = coincident || node.identity != top.identity;
+    }
+    size_t expect = 0;
+    for (size_t ind = 101; ind < ords.size() && ords[ind] <= ords[100] + delta; ++ind) {
+        expect += ords[ind] % nstreams != ords[100] % nstreams;
+    }
+    assert(coincident == (expect > 0));
+
+    std::cerr << "test_lookahead: " << name << " pass\n";
+}
+
+// Equal orderings across streams: lookahead visits each held node
+// once in order and draining then yields the same nodes.
+template <typename Queue>
+void test_ties(const char* name)
+{
+    using merge_t = zipper::merge<node_t, Queue>;
+    const size_t nstreams = 4;
+    merge_t mq(nstreams);
+
+    std::mt19937 rng(7);
+    for (size_t ind = 0; ind < 1000; ++ind) {
+        mq.feed(ind, rng() % 50, ind % nstreams);
+    }
+    std::vector<size_t> ords, pays;
+    for (const auto& node : mq.lookahead()) {
+        ords.push_back(node.ordering);
+        pays.push_back(node.payload);
+    }
+    assert(ords.size() == 1000);
+    assert(std::is_sorted(ords.begin(), ords.end()));
+    std::sort(pays.begin(), pays.end());
+    for (size_t ind = 0; ind < pays.size(); ++ind) {
+        assert(pays[ind] == ind);
+    }
+
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    std::vector<size_t> gpays;
+    for (const auto& node : got) {
+        gpays.push_back(node.payload);
+    }
+    std::sort(gpays.begin(), gpays.end());
+    assert(gpays == pays);
+    std::cerr << "test_lookahead: " << name << " ties pass\n";
+}
+
+int main()
+{
+    test_lookahead<zipper::heap_queue<node_t>>("heap");
+    test_lookahead<zipper::radix_queue<node_t>>("radix");
+    test_ties<zipper::heap_queue<node_t>>("heap");
+    test_ties<zipper::radix_queue<node_t>>("radix");
+    return 0;
+}
@@ -0,0 +1,209 @@
+// Test the radix queue backend against the default heap.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+template<typename Ordering>
+using node_tt = zipper::Node<int, Ordering>;
+
+template<typename Ordering>
+using heap_merge_t = zipper::merge<node_tt<Ordering>>;
+
+template<typename Ordering>
+using radix_merge_t = zipper::merge<node_tt<Ordering>,
+                                    zipper::radix_queue<node_tt<Ordering>>>;
+
+// Bare queue behaves as a min priority queue given monotone input.
+void test_queue()
+{
+    using node_t = node_tt<size_t>;
+    zipper::radix_queue<node_t> q;
+    assert(q.empty());
+    for (size_t ord : {5, 3, 9, 3, 7}) {
+        q.push(node_t{(int)ord, ord, 0, {}});
+    }
+    assert(q.size() == 5);
+    std::vector<size_t> got;
+    while (!q.empty()) {
+        got.push_back(q.top().ordering);
+        q.pop();
+        if (got.size() == 2) {
+            q.push(node_t{4, 4, 0, {}});
+        }
+    }
+    assert((got == std::vector<size_t>{3, 3, 4, 5, 7, 9}));
+
+    // signed orderings
+    zipper::radix_queue<node_tt<int>> sq;
+    for (int ord : {5, -3, 0, -100, 7}) {
+        sq.push(node_tt<int>{ord, ord, 0, {}});
+    }
+    std::vector<int> sgot;
+    while (!sq.empty()) {
+        sgot.push_back(sq.top().ordering);
+        sq.pop();
+    }
+    assert((sgot == std::vector<int>{-100, -3, 0, 5, 7}));
+
+    bool caught = false;
+    q.push(node_t{9, 9, 0, {}});
+    try {
+        q.push(node_t{1, 1, 0, {}});
+    }
+    catch (std::domain_error& err) {
+        caught = true;
+    }
+    assert(caught);
+    std::cerr << "test_queue: pass\n";
+}
+
+// Random streams through both merges give same orderings.
+template<typename Ordering>
+void test_random(Ordering start)
+{
+    const size_t nstreams = 20;
+    heap_merge_t<Ordering> hm(nstreams);
+    radix_merge_t<Ordering> rm(nstreams);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> step(0, 50);
+    std::uniform_int_distribution<size_t> pick(0, nstreams-1);
+    std::vector<Ordering> last(nstreams, 0);
+
+    std::vector<node_tt<Ordering>> hgot, rgot;
+    for (int count=0; count < 100000; ++count) {
+        const size_t ident = pick(rng);
+        last[ident] += step(rng);
+        // unique across streams so both tops are the same node
+        const Ordering ord = start + last[ident]*nstreams + ident;
+        assert(hm.feed(count, ord, ident));
+        assert(rm.feed(count, ord, ident));
+        if (count % 7 == 0) {
+            hm.drain_waiting(std::back_inserter(hgot));
+            rm.drain_waiting(std::back_inserter(rgot));
+            assert(hgot.size() == rgot.size());
+            assert(hm.get_origin() == rm.get_origin());
+        }
+    }
+    hm.drain_full(std::back_inserter(hgot));
+    rm.drain_full(std::back_inserter(rgot));
+    assert(hgot.size() == rgot.size());
+    for (size_t ind=0; ind<hgot.size(); ++ind) {
+        assert(hgot[ind].ordering == rgot[ind].ordering);
+    }
+
+    // clear resets the monotone floor
+    rm.clear();
+    assert(rm.feed(0, start, 0));
+    assert(rm.peek().ordering == start);
+    std::cerr << "test_random(" << start << "): pass\n";
+}
+
+// Equal orderings: pop() removes the very node top() gives.
+void test_ties()
+{
+    using node_t = node_tt<size_t>;
+    zipper::radix_queue<node_t> q;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> step(0, 2);
+    size_t ord = 0;
+    int pay = 0;
+    std::vector<int> pushed, popped;
+    for (int round = 0; round < 1000; ++round) {
+        for (int ind = 0; ind < 5; ++ind) {
+            q.push(node_t{pay, ord + step(rng), 0, {}});
+            pushed.push_back(pay++);
+        }
+        for (int ind = 0; ind < 3; ++ind) {
+            const auto top = q.top(); // copy
+            q.pop();
+            popped.push_back(top.payload);
+            assert(q.empty() || q.top().ordering >= top.ordering);
+            ord = top.ordering;
+        }
+    }
+    while (!q.empty()) {
+        popped.push_back(q.top().payload);
+        q.pop();
+    }
+    std::sort(popped.begin(), popped.end());
+    assert(popped == pushed);   // each node exactly once
+
+    // through the merge, streams tie
+    using merge_t = radix_merge_t<size_t>;
+    merge_t mq(2);
+    mq.feed(100, 5, 0);
+    mq.feed(200, 5, 1);
+    mq.feed(300, 6, 0);
+    mq.feed(400, 6, 1);
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    std::vector<int> pays;
+    for (const auto& node : got) {
+        pays.push_back(node.payload);
+    }
+    std::sort(pays.begin(), pays.end());
+    assert((pays == std::vector<int>{100, 200, 300, 400}));
+    assert(mq.stats(0).occupancy == 0);
+    assert(mq.stats(1).occupancy == 0);
+    std::cerr << "test_ties: pass\n";
+}
+
+// Streams with shared orderings through both merges.
+void test_random_ties()
+{
+    using node_t = node_tt<size_t>;
+    const size_t nstreams = 10;
+    heap_merge_t<size_t> hm(nstreams);
+    radix_merge_t<size_t> rm(nstreams);
+
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> step(0, 3);
+    std::uniform_int_distribution<size_t> pick(0, nstreams-1);
+    std::vector<size_t> last(nstreams, 0);
+    std::vector<node_t> hgot, rgot;
+    for (int count=0; count < 100000; ++count) {
+        const size_t ident = pick(rng);
+        last[ident] += step(rng);
+        hm.feed(count, last[ident], ident);
+        rm.feed(count, last[ident], ident);
+        if (count % 7 == 0) {
+            rm.drain_waiting(std::back_inserter(rgot));
+        }
+    }
+    hm.drain_full(std::back_inserter(hgot));
+    rm.drain_full(std::back_inserter(rgot));
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        assert(rm.stats(ident).occupancy == 0);
+    }
+    assert(hgot.size() == rgot.size());
+    for (size_t ind = 1; ind < rgot.size(); ++ind) {
+        assert(rgot[ind-1].ordering <= rgot[ind].ordering);
+    }
+    auto pays = [](const std::vector<node_t>& nodes) {
+        std::vector<int> ret;
+        for (const auto& node : nodes) {
+            ret.push_back(node.payload);
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    };
+    assert(pays(hgot) == pays(rgot));
+    std::cerr << "test_random_ties: pass\n";
+}
+
+int main()
+{
+    test_queue();
+    test_ties();
+    test_random_ties();
+    test_random<size_t>(0);
+    test_random<int>(1000);
+    test_random<long>(1000000000);
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Test deduplication of redundant streams, first arrival wins.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <string>
+
+using node_t = zipper::Node<std::string>;
+using merge_t = zipper::merge<node_t>;
+
+merge_t::timepoint_t us(int micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+std::vector<std::string> payloads(const std::vector<node_t>& nodes)
+{
+    std::vector<std::string> ret;
+    for (const auto& node : nodes) {
+        ret.push_back(node.payload);
+    }
+    return ret;
+}
+
+void test_dedup()
+{
+    // group 0 is read over links 10 and 11, stream 1 is plain
+    merge_t mq(2);
+    mq.add_redundant(0, 10);
+    mq.add_redundant(0, 11);
+    std::vector<node_t> got;
+
+    //              pay, ord, ident
+    assert( mq.feed("x1", 1, 10));
+    assert(!mq.feed("y1", 1, 11)); // copy
+    assert( mq.feed("y2", 2, 11)); // 11 is ahead
+    assert(!mq.feed("x2", 2, 10));
+    assert( mq.feed("x3", 3, 10)); // 11 lost its 3
+    assert( mq.feed("y4", 4, 11));
+    assert(mq.duplicates(0) == 2);
+    assert(mq.size() == 4);
+    assert(mq.stats(10).occupancy == 4); // the group's
+    assert(mq.stats(0).occupancy == 4);
+
+    assert(!mq.complete());     // waits on stream 1
+    assert(mq.feed("b9", 9, 1));
+    mq.drain_waiting(std::back_inserter(got));
+    assert((payloads(got) == std::vector<std::string>{"x1", "y2", "x3"}));
+
+    // the group is represented by either member
+    assert(!mq.feed("x4", 4, 10));
+    assert(mq.feed("x5", 5, 10));
+    mq.drain_waiting(std::back_inserter(got));
+    assert(got.back().payload == "y4");
+    assert(mq.duplicates(0) == 3);
+    assert(mq.late_size() == 0);
+
+    // late member may not join
+    mq.feed("c1", 10, 2);
+    bool threw = false;
+    try {
+        mq.add_redundant(1, 2);
+    }
+    catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_slow_path()
+{
+    // one slow path does not hold back output of its group
+    merge_t mq(2, std::chrono::microseconds(10));
+    mq.add_redundant(0, 10);
+    mq.add_redundant(0, 11);
+    std::vector<node_t> got;
+
+    mq.feed("x1", 1, 10, us(0));
+    mq.feed("x2", 2, 10, us(0));
+    mq.feed("b1", 1, 1, us(0));
+    mq.feed("b3", 3, 1, us(0));
+    mq.drain_prompt(std::back_inserter(got), us(1));
+    assert((payloads(got) == std::vector<std::string>{"x1", "b1"}));
+
+    // the slow path catches up with copies
+    assert(!mq.feed("y1", 1, 11, us(2)));
+    assert(!mq.feed("y2", 2, 11, us(2)));
+    assert( mq.feed("y5", 5, 11, us(2)));
+    mq.drain_prompt(std::back_inserter(got), us(3));
+    assert((payloads(got) == std::vector<std::string>{"x1", "b1", "x2"}));
+}
+
+// Copies from a path running behind the drained output are duplicates,
+// not late data.
+void test_behind()
+{
+    merge_t mq(1);
+    mq.add_redundant(0, 0);
+    mq.add_redundant(0, 1);
+    mq.keep_late();
+    std::vector<node_t> got;
+    for (size_t ord = 1; ord <= 5; ++ord) {
+        assert(mq.feed("x", ord, 0));
+    }
+    mq.drain_full(std::back_inserter(got));
+    assert(got.size() == 5);
+    for (size_t ord = 1; ord <= 5; ++ord) {
+        assert(!mq.feed("y", ord, 1));
+    }
+    assert(mq.duplicates(0) == 5);
+    assert(mq.late_size() == 0);
+}
+
+// A silent path does not make the group remember every ordering.
+void test_silent()
+{
+    merge_t mq(1);
+    mq.add_redundant(0, 0);
+    mq.add_redundant(0, 1);     // never feeds
+    mq.remember_drained(8);
+    std::vector<node_t> got;
+    for (size_t ord = 1; ord <= 100000; ++ord) {
+        assert(mq.feed("x", ord, 0));
+        mq.drain_full(std::back_inserter(got));
+    }
+    assert(got.size() == 100000);
+    assert(!mq.feed("y", 99995, 1)); // still remembered
+    assert(mq.duplicates(0) == 1);
+    assert(!mq.feed("y", 5, 1));     // forgotten, so tardy
+    assert(mq.duplicates(0) == 1);
+}
+
+// Erasing a group's stream removes the nodes of all its members.
+void test_erase()
+{
+    merge_t mq(2);
+    mq.add_redundant(0, 10);
+    mq.add_redundant(0, 11);
+    mq.feed("x1", 1, 10);
+    mq.feed("y2", 2, 11);
+    mq.feed("b1", 1, 1);
+    assert(mq.erase_stream(0) == 2);
+    assert(mq.size() == 1 && mq.stats(0).occupancy == 0);
+    mq.feed("x3", 3, 10);
+    mq.feed("y4", 4, 11);
+    assert(mq.erase_stream(11) == 2);
+    assert(mq.size() == 1);
+}
+
+int main()
+{
+    test_behind();
+    test_silent();
+    test_erase();
+    test_dedup();
+    test_slow_path();
+    std::cerr << "test_redundant: pass\n";
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Test running many merges on a thread pool.
+
+#include "zipper.hpp"
+#include "zipper/scheduler.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using node_t = zipper::Node<size_t>;
+using merge_t = zipper::merge<node_t>;
+using scheduler_t = zipper::scheduler<merge_t>;
+
+struct Output {
+    std::mutex mutex;
+    std::vector<size_t> ords;
+};
+
+// Wait until the condition holds or give up.
+template<typename Cond>
+bool await(Cond cond)
+{
+    for (int tries = 0; tries < 5000; ++tries) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+int main()
+{
+    const size_t nmerges = 50;
+    const size_t nstreams = 3;
+    const size_t nsend = 200;
+
+    scheduler_t sched;
+    std::vector<Output> outputs(nmerges);
+    auto sink = [&](size_t id, const std::vector<node_t>& nodes) {
+        auto& out = outputs[id];
+        std::lock_guard<std::mutex> lk(out.mutex);
+        for (const auto& node : nodes) {
+            out.ords.push_back(node.ordering);
+        }
+    };
+    for (size_t ind = 0; ind < nmerges; ++ind) {
+        // odd merges have a latency bound
+        auto latency = std::chrono::milliseconds(ind % 2 ? 20 : 0);
+        assert(sched.add(nstreams, latency, sink) == ind);
+    }
+    sched.start(4);
+
+    // one feeder thread per stream
+    std::vector<std::thread> feeders;
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        feeders.emplace_back([&, ident] {
+            for (size_t ord = 0; ord < nsend; ++ord) {
+                for (size_t id = 0; id < nmerges; ++id) {
+                    node_t node{ord, ord*nstreams + ident, ident,
+                                merge_t::clock_t::now()};
+                    sched.feed(id, node);
+                }
+            }
+        });
+    }
+    for (auto& th : feeders) {
+        th.join();
+    }
+
+    // Lossless merges hold back the last node of each stream.  Those
+    // with a latency bound drain all once streams go stale but may
+    // reject nodes from a feeder thread which stalled.
+    for (size_t id = 0; id < nmerges; ++id) {
+        const bool lossless = id % 2 == 0;
+        const size_t nfed = nsend*nstreams;
+        const bool ok = await([&] {
+            auto st = sched.stats(id);
+            return st.drained + st.rejected == (lossless ? nfed - nstreams : nfed);
+        });
+        assert(ok);
+        auto st = sched.stats(id);
+        assert(st.fed == nfed);
+        assert(st.runs > 0);
+        std::lock_guard<std::mutex> lk(outputs[id].mutex);
+        const auto& ords = outputs[id].ords;
+        assert(ords.size() == st.drained);
+        for (size_t ind = 1; ind < ords.size(); ++ind) {
+            assert(ords[ind-1] < ords[ind]);
+        }
+        if (lossless) {
+            assert(st.rejected == 0);
+            for (size_t ind = 0; ind < ords.size(); ++ind) {
+                assert(ords[ind] == ind);
+            }
+        }
+    }
+    sched.stop();
+
+    // feed while stopped, run once restarted
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        const size_t ord = nsend*nstreams + ident;
+        sched.feed(0, node_t{ord, ord, ident, merge_t::clock_t::now()});
+    }
+    sched.start(2);
+    const bool ok = await([&] {
+        return sched.stats(0).drained == nsend*nstreams;
+    });
+    assert(ok);
+
+    // feed across restarts
+    const size_t nmore = 2000;
+    std::thread feeder([&] {
+        for (size_t ord = nsend; ord < nsend + nmore; ++ord) {
+            for (size_t ident = 0; ident < nstreams; ++ident) {
+                sched.feed(2, node_t{ord, ord*nstreams + ident, ident,
+                                     merge_t::clock_t::now()});
+            }
+        }
+    });
+    for (size_t cycle = 0; cycle < 20; ++cycle) {
+        sched.stop();
+        sched.start(1 + cycle % 3);
+    }
+    feeder.join();
+    const bool more = await([&] {
+        return sched.stats(2).drained == (nsend + nmore - 1)*nstreams;
+    });
+    assert(more);
+    {
+        std::lock_guard<std::mutex> lk(outputs[2].mutex);
+        const auto& ords = outputs[2].ords;
+        for (size_t ind = 0; ind < ords.size(); ++ind) {
+            assert(ords[ind] == ind);
+        }
+    }
+    sched.stop();
+
+    std::cerr << "test_scheduler: pass\n";
+    return 0;
+}
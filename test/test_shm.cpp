@@ -0,0 +1,230 @@
+// Test merging streams fed from forked producer processes through
+// shared memory rings.
+
+#include "zipper/shm.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Payload {
+    size_t ident, count;
+    double data[6];
+};
+
+using node_t = zipper::Node<const Payload*>;
+using merge_t = zipper::merge<node_t>;
+using source_t = zipper::shm_source<merge_t>;
+using ring_t = source_t::ring_t;
+
+const size_t nstreams = 3;
+const size_t nsend = 20000;
+
+std::string ring_name(size_t ident)
+{
+    return "/zipper-test-" + std::to_string(::getpid()) + "-" + std::to_string(ident);
+}
+
+// Child: open ring by name and push ordered payloads.
+void produce(const std::string& name, size_t ident)
+{
+    auto ring = ring_t::open(name);
+    for (size_t count = 0; count < nsend; ++count) {
+        const Payload pay{ident, count, {0,1,2,3,4,5}};
+        while (!ring.push(count*nstreams + ident, pay)) {
+            ::usleep(10);
+        }
+    }
+}
+
+void test_ring()
+{
+    const auto name = ring_name(99);
+    auto ring = ring_t::create(name, 5);
+    assert(ring.capacity() == 8);
+    auto other = ring_t::open(name);
+    ring_t::unlink(name);
+    for (size_t ind=0; ind<8; ++ind) {
+        assert(ring.push(ind, Payload{0, ind, {}}));
+    }
+    assert(!ring.push(8, Payload{}));
+    assert(other.head() == 8);
+    assert(other.at(3).payload.count == 3);
+    other.release_to(2);
+    assert(ring.push(8, Payload{}));
+    bool caught = false;
+    try {
+        ring_t::open(name);
+    }
+    catch (const std::system_error& err) {
+        caught = true;
+    }
+    assert(caught);
+    std::cerr << "test_ring: pass\n";
+}
+
+void test_fork()
+{
+    merge_t mq(nstreams);
+    source_t src;
+    std::vector<pid_t> pids;
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        const auto name = ring_name(ident);
+        src.add(ident, ring_t::create(name, 64));
+        pid_t pid = ::fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            produce(name, ident);
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    std::vector<node_t> got;
+    size_t ngot = 0;
+    size_t last = 0;
+    auto consume = [&]() {
+        for (const auto& node : got) {
+            assert(node.payload->ident == node.identity);
+            assert(node.payload->count*nstreams + node.identity == node.ordering);
+            assert(node.ordering >= last);
+            last = node.ordering;
+            src.release(node);
+        }
+        ngot += got.size();
+        got.clear();
+    };
+    while (ngot + nstreams < nsend*nstreams) {
+        if (!src.poll(mq)) {
+            ::usleep(10);
+        }
+        mq.drain_waiting(std::back_inserter(got));
+        consume();
+    }
+    for (auto pid : pids) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        ring_t::unlink(ring_name(ident));
+    }
+    src.poll(mq);
+    mq.drain_full(std::back_inserter(got));
+    consume();
+    assert(ngot == nsend*nstreams);
+    for (size_t ident = 0; ident < nstreams; ++ident) {
+        assert(src.held(ident) == 0);
+    }
+    std::cerr << "test_fork: pass\n";
+}
+
+// Tardy nodes are released without the user.
+void test_tardy()
+{
+    merge_t mq(1);
+    source_t src;
+    const auto name = ring_name(98);
+    auto ring = ring_t::create(name, 8);
+    src.add(0, ring_t::open(name));
+    ring_t::unlink(name);
+
+    ring.push(5, Payload{});
+    src.poll(mq);
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    ring.push(3, Payload{});    // tardy
+    ring.push(6, Payload{});
+    assert(src.poll(mq) == 1);
+    assert(src.held(0) == 3);
+    src.release(got[0]);
+    assert(src.held(0) == 1);   // the tardy one went with it
+    assert(ring.tail() == 2);
+    std::cerr << "test_tardy: pass\n";
+}
+
+// Late nodes keep their slots until released, in any order.
+void test_late()
+{
+    merge_t mq(1);
+    mq.keep_late(1);
+    source_t src;
+    const auto name = ring_name(97);
+    auto ring = ring_t::create(name, 8);
+    src.add(0, ring_t::open(name));
+    ring_t::unlink(name);
+
+    ring.push(5, Payload{0, 5, {}});
+    src.poll(mq);
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    ring.push(3, Payload{0, 3, {}}); // kept late
+    ring.push(4, Payload{0, 4, {}}); // late but no room, released
+    ring.push(6, Payload{0, 6, {}});
+    assert(src.poll(mq) == 1);
+    assert(mq.late_size() == 1);
+    assert(src.held(0) == 4);
+
+    std::vector<merge_t::late_node> late;
+    mq.drain_late(std::back_inserter(late));
+    mq.drain_full(std::back_inserter(got));
+    src.release(got[1]);        // out of order
+    assert(ring.tail() == 0);
+    src.release(got[0]);
+    assert(ring.tail() == 1);   // the late slot is still held
+    assert(late[0].node.payload->count == 3);
+    src.release(late[0].node);
+    assert(ring.tail() == 4);
+    assert(src.held(0) == 0);
+    std::cerr << "test_late: pass\n";
+}
+
+// Erasing and clearing through the source releases the slots.
+void test_erase()
+{
+    merge_t mq(1);
+    mq.keep_late(1);
+    source_t src;
+    const auto name = ring_name(96);
+    auto ring = ring_t::create(name, 8);
+    src.add(0, ring_t::open(name));
+    ring_t::unlink(name);
+
+    for (size_t ord : {1, 2, 3, 4}) {
+        ring.push(ord, Payload{0, ord, {}});
+    }
+    src.poll(mq);
+    assert(src.held(0) == 4);
+    assert(src.erase_if(mq, [](const node_t& node) { return node.ordering < 3; }) == 2);
+    assert(mq.size() == 2);
+    assert(ring.tail() == 2);
+
+    std::vector<node_t> got;
+    mq.drain_full(std::back_inserter(got));
+    src.release(got[0]);
+    src.release(got[1]);
+    ring.push(2, Payload{0, 2, {}}); // kept late
+    ring.push(7, Payload{0, 7, {}});
+    src.poll(mq);
+    assert(mq.size() == 1 && mq.late_size() == 1);
+    assert(src.held(0) == 2);
+    src.clear(mq);
+    assert(mq.empty() && mq.late_size() == 0);
+    assert(src.held(0) == 0);
+    assert(ring.tail() == 6);
+    std::cerr << "test_erase: pass\n";
+}
+
+int main()
+{
+    test_ring();
+    test_fork();
+    test_tardy();
+    test_late();
+    test_erase();
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Test merge trace hooks.
+
+#include "zipper/trace.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Count hook calls.
+struct count_trace {
+    static inline int nbegin{0}, nend{0}, naccept{0}, nreject{0},
+        npop{0}, ncomplete{0}, nincomplete{0}, nstale{0};
+    static void begin(zipper::probe) { ++nbegin; }
+    static void end(zipper::probe) { ++nend; }
+    template<typename Node> static void accept(const Node&) { ++naccept; }
+    template<typename Node> static void reject(const Node&) { ++nreject; }
+    template<typename Node> static void pop(const Node&) { ++npop; }
+    static void decide(bool ok) { ok ? ++ncomplete : ++nincomplete; }
+    template<typename Identity> static void stale(const Identity&) { ++nstale; }
+};
+
+using node_t = zipper::Node<int>;
+
+template<typename Trace>
+using merge_tt = zipper::merge<node_t, zipper::heap_queue<node_t>, Trace>;
+
+node_t::timepoint_t us(int micros)
+{
+    node_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+// Feed two streams and let one go stale.
+template<typename Merge>
+void exercise(Merge& mq)
+{
+    std::vector<node_t> got;
+    mq.feed(1, 1, 0, us(0));
+    mq.feed(2, 2, 1, us(0));
+    mq.feed(3, 3, 0, us(1));
+    mq.drain_prompt(std::back_inserter(got), us(2)); // pops 1
+    mq.feed(0, 0, 1, us(2));                        // tardy
+    mq.drain_prompt(std::back_inserter(got), us(20)); // 1 goes stale
+    assert(got.size() == 3);
+}
+
+void test_hooks()
+{
+    merge_tt<count_trace> mq(2, std::chrono::microseconds(10));
+    exercise(mq);
+    assert(count_trace::nbegin == count_trace::nend);
+    assert(count_trace::naccept == 3);
+    assert(count_trace::nreject == 1);
+    assert(count_trace::npop == 3);
+    assert(count_trace::ncomplete == 3);
+    assert(count_trace::nincomplete == 2);
+    assert(count_trace::nstale == 1);
+    std::cerr << "test_hooks: pass\n";
+}
+
+void test_ring()
+{
+    using trace_t = zipper::ring_trace<64>;
+    {
+        merge_tt<trace_t> mq(2, std::chrono::microseconds(10));
+        exercise(mq);
+    }
+    std::thread other([]{
+        for (int count=0; count<2; ++count) { // wraps around the ring
+            merge_tt<trace_t> mq(2, std::chrono::microseconds(10));
+            exercise(mq);
+        }
+    });
+    other.join();
+
+    const auto all = trace_t::events();
+    assert(all.size() == 2);
+    assert(all[0].size() < 64);
+    assert(all[1].size() == 64);
+    for (const auto& evs : all) {
+        for (size_t ind=1; ind<evs.size(); ++ind) {
+            assert(evs[ind-1].when <= evs[ind].when);
+        }
+    }
+
+    std::stringstream ss;
+    trace_t::dump(ss);
+    const auto json = ss.str();
+    assert(json.find("{\"traceEvents\":[") == 0);
+    assert(json.find("\"name\":\"drain_prompt\",\"ph\":\"B\"") != std::string::npos);
+    assert(json.find("\"name\":\"reject\"") != std::string::npos);
+    assert(json.find("\"name\":\"stale\"") != std::string::npos);
+    assert(json.find("\"tid\":1") != std::string::npos);
+    std::cerr << "test_ring: pass\n";
+}
+
+int main()
+{
+    test_hooks();
+    test_ring();
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Test draining a merge in ordering windows.
+
+#include "zipper.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <string>
+
+using node_t = zipper::Node<std::string>;
+using merge_t = zipper::merge<node_t>;
+using window_t = zipper::window<merge_t>;
+
+merge_t::timepoint_t us(int micros)
+{
+    merge_t::timepoint_t ret;
+    ret += std::chrono::microseconds(micros);
+    return ret;
+}
+
+struct Batch {
+    size_t lo;
+    std::vector<std::string> pays;
+};
+
+struct Collect {
+    std::vector<Batch>& got;
+    void operator()(size_t lo, const node_t* first, const node_t* last) {
+        Batch b{lo, {}};
+        for (; first != last; ++first) {
+            b.pays.push_back(first->payload);
+        }
+        got.push_back(b);
+    }
+};
+
+void test_width()
+{
+    merge_t mq(2);
+    window_t win(mq, 10);
+    std::vector<Batch> got;
+    Collect collect{got};
+
+    //       pay, ord, ident
+    mq.feed("a1", 1, 0);
+    mq.feed("a5", 5, 0);
+    mq.feed("b3", 3, 1);
+    mq.feed("a12", 12, 0);
+    assert(win.drain_waiting(collect) == 0);
+    assert(got.empty());        // stream 1 may still send into [0,10)
+
+    mq.feed("b11", 11, 1);
+    assert(win.drain_waiting(collect) == 1);
+    assert(got.size() == 1);
+    assert(got[0].lo == 0);
+    assert(got[0].pays.size() == 3);
+    assert(got[0].pays[0] == "a1");
+    assert(got[0].pays[1] == "b3");
+    assert(got[0].pays[2] == "a5");
+    assert(mq.size() == 2);
+
+    mq.feed("b25", 25, 1);
+    mq.feed("a31", 31, 0);
+    assert(win.drain_waiting(collect) == 1);
+    assert(got.size() == 2);
+    assert(got[1].lo == 10);
+    assert(got[1].pays.size() == 2);
+    assert(win.drain_waiting(collect) == 0);
+
+    // remaining in [20,30) and [30,40).
+    assert(win.drain_full(collect) == 2);
+    assert(got.size() == 4);
+    assert(got[2].lo == 20 && got[2].pays[0] == "b25");
+    assert(got[3].lo == 30 && got[3].pays[0] == "a31");
+    assert(mq.empty());
+    assert(win.pending() == 0);
+    std::cerr << "test_width: pass\n";
+}
+
+void test_equal()
+{
+    merge_t mq(3);
+    window_t win(mq);
+    std::vector<Batch> got;
+    Collect collect{got};
+
+    for (size_t ord : {1, 2, 3}) {
+        for (size_t ident : {0, 1, 2}) {
+            mq.feed(std::to_string(ord), ord, ident);
+        }
+    }
+    assert(win.drain_waiting(collect) == 2);
+    for (size_t ind=0; ind<2; ++ind) {
+        assert(got[ind].lo == ind+1);
+        assert(got[ind].pays.size() == 3);
+    }
+    std::cerr << "test_equal: pass\n";
+}
+
+void test_prompt()
+{
+    merge_t mq(2, std::chrono::microseconds(10));
+    window_t win(mq, 10);
+    std::vector<Batch> got;
+    Collect collect{got};
+
+    mq.feed("a1", 1, 0, us(0));
+    mq.feed("b2", 2, 1, us(0));
+    mq.feed("a11", 11, 0, us(1));
+    assert(win.drain_prompt(collect, us(5)) == 0);
+    assert(win.pending() == 1); // a1 left the merge but b may yet send
+
+    // stream 1 goes stale, window is forced closed.  Then stream 0
+    // is stale too and its last window closes on an empty merge.
+    assert(win.drain_prompt(collect, us(20)) == 2);
+    assert(got[0].lo == 0);
+    assert(got[0].pays.size() == 2);
+    assert(got[1].lo == 10);
+    assert(got[1].pays[0] == "a11");
+    assert(mq.empty());
+    assert(!mq.feed("b5", 5, 1, us(31)));
+    std::cerr << "test_prompt: pass\n";
+}
+
+// A straggler into a window already forced closed is not emitted again.
+void test_straggler()
+{
+    merge_t mq(2, std::chrono::microseconds(10));
+    mq.keep_late();
+    window_t win(mq, 10);
+    std::vector<Batch> got;
+    Collect collect{got};
+
+    mq.feed("a1", 1, 0, us(0));
+    mq.feed("b2", 2, 1, us(0));
+    mq.feed("a3", 3, 0, us(0));
+    mq.feed("a15", 15, 0, us(15));
+    assert(win.drain_prompt(collect, us(20)) == 1); // b is stale
+    assert(got[0].lo == 0);
+    assert(got[0].pays.size() == 3);
+    assert(mq.get_origin() == 10);
+
+    assert(!mq.feed("b5", 5, 1, us(21)));
+    assert(mq.late_size() == 1);
+    assert(mq.feed("b16", 16, 1, us(21)));
+    assert(win.drain_full(collect) == 1);
+    assert(got.size() == 2);
+    assert(got[1].lo == 10);
+    assert(got[1].pays.size() == 2);
+
+    // zero width windows close at the next ordering
+    merge_t mq0(2, std::chrono::microseconds(10));
+    window_t win0(mq0);
+    std::vector<Batch> got0;
+    Collect collect0{got0};
+    mq0.feed("a5", 5, 0, us(0));
+    mq0.feed("b5", 5, 1, us(0));
+    mq0.feed("a6", 6, 0, us(0));
+    assert(win0.drain_prompt(collect0, us(20)) == 2);
+    assert(!mq0.feed("b6", 6, 1, us(21)));
+    assert(mq0.feed("b7", 7, 1, us(21)));
+    std::cerr << "test_straggler: pass\n";
+}
+
+// Windows closed on a stale stream declare it as the merge does.
+void test_stale()
+{
+    auto feed = [](merge_t& mq) {
+        mq.feed("a1", 1, 0, us(0));
+        mq.feed("b2", 2, 1, us(0));
+        mq.feed("a3", 3, 0, us(0));
+        mq.feed("a15", 15, 0, us(15));
+    };
+    merge_t plain(2, std::chrono::microseconds(10));
+    feed(plain);
+    std::vector<node_t> out;
+    plain.drain_prompt(std::back_inserter(out), us(20));
+    assert(plain.stats(1).stale == 1);
+
+    merge_t mq(2, std::chrono::microseconds(10));
+    window_t win(mq, 10);
+    std::vector<Batch> got;
+    Collect collect{got};
+    feed(mq);
+    assert(win.drain_waiting(collect) == 0);
+    assert(mq.stats(1).stale == 0);
+    assert(win.drain_prompt(collect, us(20)) == 1);
+    assert(mq.stats(1).stale == 1);
+    assert(mq.stats(0).stale == 0);
+    assert(win.drain_prompt(collect, us(21)) == 0);
+    assert(mq.stats(1).stale == 1); // once per absence
+
+    // a join does the same
+    merge_t mqj(2, std::chrono::microseconds(10));
+    zipper::join<merge_t> jn(mqj, {0, 1});
+    feed(mqj);
+    size_t ntuples = 0;
+    jn.drain_prompt([&](size_t, const node_t* const*, const node_t* const*) {
+        ++ntuples;
+    }, us(20));
+    assert(ntuples == 3);
+    assert(mqj.stats(1).stale == 1);
+    std::cerr << "test_stale: pass\n";
+}
+
+int main()
+{
+    test_width();
+    test_equal();
+    test_prompt();
+    test_straggler();
+    test_stale();
+    return 0;
+}
@@ -6,10 +6,166 @@
 #include <vector>
 #include <functional>
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <algorithm>
 #include <stdexcept>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <cmath>
+#include <array>
+#include <limits>
+#include <iterator>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace zipper {
 
+    /**
+       Clocks.
+
+       The merge takes its notion of "now" from the clock of the
+       Node's time point type.  Any clock meeting the std::chrono
+       Clock requirements may be used.  Besides the std clocks, the
+       following are provided for cases where reading the system
+       clock per node is too costly or where time must be simulated.
+
+       All keep their state per thread.
+    */
+
+    /**
+       A coarse clock which returns a cached time point.
+
+       The cached value is refreshed from the Base clock only when
+       tick() is called, eg once per batch of feed()/drain calls.
+       Prior to the first tick() the time is the Base clock epoch.
+    */
+    template <typename Base = std::chrono::steady_clock>
+    struct coarse_clock {
+        using base_clock = Base;
+        using duration = typename Base::duration;
+        using rep = typename duration::rep;
+        using period = typename duration::period;
+        using time_point = std::chrono::time_point<coarse_clock, duration>;
+        static constexpr bool is_steady = Base::is_steady;
+
+        static time_point now() noexcept {
+            return cached();
+        }
+
+        /// Refresh the cached time from the base clock and return it.
+        static time_point tick() noexcept {
+            return cached() = time_point(Base::now().time_since_epoch());
+        }
+
+      private:
+        static time_point& cached() noexcept {
+            static thread_local time_point tp{};
+            return tp;
+        }
+    };
+
+    /**
+       A clock reading the CPU time stamp counter.
+
+       The counter is calibrated against the Base clock once, on the
+       first call to now() or calibrate().  This assumes an invariant
+       TSC which all recent x86 CPUs provide.  On other architectures
+       this simply forwards to the Base clock.
+    */
+    template <typename Base = std::chrono::steady_clock>
+    struct tsc_clock {
+        using base_clock = Base;
+        using duration = std::chrono::nanoseconds;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::time_point<tsc_clock, duration>;
+        static constexpr bool is_steady = Base::is_steady;
+
+        static time_point now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            const auto& cal = calibrate();
+            const double dticks = static_cast<double>(__rdtsc() - cal.ticks0);
+            return cal.time0 + duration(static_cast<rep>(dticks * cal.ns_per_tick));
+#else
+            return time_point(std::chrono::duration_cast<duration>(
+                                  Base::now().time_since_epoch()));
+#endif
+        }
+
+        struct calibration {
+            unsigned long long ticks0{0};
+            time_point time0{};
+            double ns_per_tick{1.0};
+        };
+
+        /**
+           Return the calibration, performing it on first call.
+
+           Calibration spins for about 10 ms.  Call this early to keep
+           that cost out of the first now().
+        */
+        static const calibration& calibrate() {
+            static const calibration cal = measure();
+            return cal;
+        }
+
+      private:
+        static calibration measure() {
+            calibration cal;
+#if defined(__x86_64__) || defined(__i386__)
+            const auto b0 = Base::now();
+            const auto t0 = __rdtsc();
+            auto b1 = b0;
+            while (b1 - b0 < std::chrono::milliseconds(10)) {
+                b1 = Base::now();
+            }
+            const auto t1 = __rdtsc();
+            const double ns = std::chrono::duration_cast<duration>(b1 - b0).count();
+            cal.ns_per_tick = ns / static_cast<double>(t1 - t0);
+            cal.ticks0 = t1;
+            cal.time0 = time_point(std::chrono::duration_cast<duration>(
+                                       b1.time_since_epoch()));
+#endif
+            return cal;
+        }
+    };
+
+    /**
+       A logical clock for simulation.
+
+       Time only changes when explicitly set() or advance()'d.
+    */
+    struct logical_clock {
+        using duration = std::chrono::nanoseconds;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::time_point<logical_clock, duration>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() noexcept {
+            return current();
+        }
+
+        static void set(const time_point& tp) noexcept {
+            current() = tp;
+        }
+
+        static time_point advance(const duration& dt) noexcept {
+            return current() += dt;
+        }
+
+      private:
+        static time_point& current() noexcept {
+            static thread_local time_point tp{};
+            return tp;
+        }
+    };
+
     /**
        Prototype node for tracking elements in the zipper queue.
 
@@ -22,6 +178,7 @@ namespace zipper {
        "identity" are so grouped.
 
        The "debut" is the time point which the node entered the queue.
+       Its clock is the clock used by the merge, see the clocks above.
     */
     template <typename Payload,
               typename Ordering = size_t,
@@ -47,6 +204,548 @@ namespace zipper {
         }
     };
 
+    /**
+       A node without a debut and with narrow ordering and identity.
+
+       This roughly halves the size of a node with a small payload.
+       Without a debut, a merge of such nodes can not provide latency
+       guarantees and must be lossless (zero max latency).
+
+       The TimePoint gives the merge its clock for the benefit of the
+       drain interface but no time point is stored.
+    */
+    template <typename Payload,
+              typename Ordering = uint32_t,
+              typename Identity = uint16_t,
+              typename TimePoint = std::chrono::steady_clock::time_point>
+    struct CompactNode {
+        using payload_t = Payload;
+        using ordering_t = Ordering;
+        using identity_t = Identity;
+        using timepoint_t = TimePoint;
+
+        payload_t payload;
+        ordering_t ordering;
+        identity_t identity;
+
+        bool operator<(const CompactNode& rhs) const {
+            return ordering < rhs.ordering;
+        }
+        bool operator>(const CompactNode& rhs) const {
+            return ordering > rhs.ordering;
+        }
+    };
+
+    /**
+       How the merge and its helpers access a node.
+
+       The default works with any Node type providing the types and
+       members of @ref Node, with "debut" being optional.  A node
+       type with a different layout may be used by specializing this.
+    */
+    template <typename Node, typename = void>
+    struct node_traits {
+        using payload_t = typename Node::payload_t;
+        using ordering_t = typename Node::ordering_t;
+        using identity_t = typename Node::identity_t;
+        using timepoint_t = typename Node::timepoint_t;
+
+        static constexpr bool has_debut = false;
+
+        static const payload_t& payload(const Node& node) {
+            return node.payload;
+        }
+        static const ordering_t& ordering(const Node& node) {
+            return node.ordering;
+        }
+        static const identity_t& identity(const Node& node) {
+            return node.identity;
+        }
+        static timepoint_t debut(const Node&) {
+            return timepoint_t::min();
+        }
+        static void set_debut(Node&, const timepoint_t&) {
+        }
+        static Node make(const payload_t& pay, const ordering_t& ord,
+                         const identity_t& ident, const timepoint_t&) {
+            return Node{pay, ord, ident};
+        }
+    };
+
+    // Nodes with a debut.
+    template <typename Node>
+    struct node_traits<Node, decltype(void(std::declval<Node&>().debut))>
+        : node_traits<Node, int> {
+        using base = node_traits<Node, int>;
+        using typename base::payload_t;
+        using typename base::ordering_t;
+        using typename base::identity_t;
+        using typename base::timepoint_t;
+
+        static constexpr bool has_debut = true;
+
+        static timepoint_t debut(const Node& node) {
+            return node.debut;
+        }
+        static void set_debut(Node& node, const timepoint_t& debut) {
+            node.debut = debut;
+        }
+        static Node make(const payload_t& pay, const ordering_t& ord,
+                         const identity_t& ident, const timepoint_t& debut) {
+            return Node{pay, ord, ident, debut};
+        }
+    };
+
+    /**
+       Points in the merge which may be traced, see @ref null_trace.
+    */
+    enum class probe {
+        feed, next, complete, drain_full, drain_prompt, drain_waiting, erase
+    };
+
+    inline const char* probe_name(probe p) {
+        switch (p) {
+            case probe::feed: return "feed";
+            case probe::next: return "next";
+            case probe::complete: return "complete";
+            case probe::drain_full: return "drain_full";
+            case probe::drain_prompt: return "drain_prompt";
+            case probe::drain_waiting: return "drain_waiting";
+            case probe::erase: return "erase";
+        }
+        return "unknown";
+    }
+
+    /**
+       The default trace of the merge which does nothing.
+
+       A merge calls these static hooks of its Trace parameter.  A
+       replacement must provide all of them.  With this default they
+       compile away.  See zipper/trace.hpp for a recording trace.
+    */
+    struct null_trace {
+        // Enter and leave a probed method.
+        static void begin(probe) {}
+        static void end(probe) {}
+
+        // A node fed to the merge was accepted or rejected.
+        template<typename Node>
+        static void accept(const Node&) {}
+        template<typename Node>
+        static void reject(const Node&) {}
+
+        // A node was removed from the merge.
+        template<typename Node>
+        static void pop(const Node&) {}
+
+        // The result of a completeness check.
+        static void decide(bool) {}
+
+        // An unrepresented stream was declared stale to drain a node.
+        template<typename Identity>
+        static void stale(const Identity&) {}
+    };
+
+    /**
+       Bracket a scope with begin/end trace hooks.
+    */
+    template <typename Trace>
+    struct trace_scope {
+        const probe what;
+        explicit trace_scope(probe p) : what(p) { Trace::begin(what); }
+        ~trace_scope() { Trace::end(what); }
+    };
+
+    /**
+       Streaming estimate of one quantile by the P-squared algorithm
+       of Jain and Chlamtac.
+
+       Five markers are kept and adjusted by piecewise parabolic
+       interpolation so each sample costs O(1) time and the whole
+       estimator O(1) space.  Until five samples are seen the exact
+       quantile of those seen is given.
+    */
+    class p2_quantile {
+    public:
+        explicit p2_quantile(double p = 0.5) : p(p) {
+            reset();
+        }
+
+        void reset() {
+            num = 0;
+            for (int ind = 0; ind < 5; ++ind) {
+                pos[ind] = ind;
+            }
+            want = {0, 2*p, 4*p, 2 + 2*p, 4};
+            step = {0, p/2, p, (1 + p)/2, 1};
+        }
+
+        double quantile() const { return p; }
+        size_t count() const { return num; }
+
+        void add(double x) {
+            if (num < 5) {
+                height[num++] = x;
+                std::sort(height.begin(), height.begin() + num);
+                return;
+            }
+            ++num;
+            int cell;
+            if (x < height[0]) {
+                height[0] = x;
+                cell = 0;
+            }
+            else if (x >= height[4]) {
+                height[4] = std::max(height[4], x);
+                cell = 3;
+            }
+            else {
+                cell = 0;
+                while (x >= height[cell + 1]) {
+                    ++cell;
+                }
+            }
+            for (int ind = cell + 1; ind < 5; ++ind) {
+                pos[ind] += 1;
+            }
+            for (int ind = 0; ind < 5; ++ind) {
+                want[ind] += step[ind];
+            }
+            for (int ind = 1; ind < 4; ++ind) {
+                const double d = want[ind] - pos[ind];
+                if ((d >= 1 && pos[ind + 1] - pos[ind] > 1) ||
+                    (d <= -1 && pos[ind - 1] - pos[ind] < -1)) {
+                    const int sgn = d > 0 ? 1 : -1;
+                    double h = parabolic(ind, sgn);
+                    if (!(height[ind - 1] < h && h < height[ind + 1])) {
+                        h = linear(ind, sgn);
+                    }
+                    height[ind] = h;
+                    pos[ind] += sgn;
+                }
+            }
+        }
+
+        /// The current estimate, zero if nothing was added.
+        double value() const {
+            if (num == 0) {
+                return 0;
+            }
+            if (num < 5) {
+                return height[std::min<size_t>(num - 1, p*num)];
+            }
+            return height[2];
+        }
+
+    private:
+        double parabolic(int i, int d) const {
+            const double np = pos[i + 1], n = pos[i], nm = pos[i - 1];
+            return height[i] + d/(np - nm) *
+                ((n - nm + d)*(height[i + 1] - height[i])/(np - n) +
+                 (np - n - d)*(height[i] - height[i - 1])/(n - nm));
+        }
+        double linear(int i, int d) const {
+            return height[i] + d*(height[i + d] - height[i])/(pos[i + d] - pos[i]);
+        }
+
+        double p;
+        size_t num{0};
+        std::array<double, 5> height{}, pos{}, want{}, step{};
+    };
+
+    /**
+       The default queue of the merge: a binary min-heap.
+    */
+    template <typename Node>
+    using heap_queue = std::priority_queue<Node,
+                                           std::vector<Node>,
+                                           std::greater<Node>>;
+
+    /**
+       True if Queue is a std::priority_queue.
+
+       The merge reaches into its protected container to erase nodes
+       in bulk.  Other queues must provide erase_if() and clear().
+    */
+    template <typename Queue>
+    struct is_priority_queue : std::false_type {};
+    template <typename T, typename Container, typename Compare>
+    struct is_priority_queue<std::priority_queue<T, Container, Compare>>
+        : std::true_type {};
+
+    /**
+       Visit the elements of a binary heap in order without
+       modifying it.
+
+       A small auxiliary heap holds indices of the frontier of
+       visited nodes.  Visiting m elements costs O(m log m)
+       independent of the size of the heap.  The heap must not be
+       modified while a cursor is in use.
+    */
+    template <typename Container, typename Compare>
+    class heap_cursor {
+    public:
+        using value_type = typename Container::value_type;
+
+        heap_cursor(const Container& heap, const Compare& comp)
+            : heap(&heap), comp(comp)
+        {
+            if (!heap.empty()) {
+                frontier.push_back(0);
+            }
+        }
+
+        /// Return the next element or nullptr when exhausted.
+        const value_type* next() {
+            if (frontier.empty()) {
+                return nullptr;
+            }
+            auto before = [this](size_t a, size_t b) {
+                return comp((*heap)[a], (*heap)[b]);
+            };
+            std::pop_heap(frontier.begin(), frontier.end(), before);
+            const size_t ind = frontier.back();
+            frontier.pop_back();
+            for (size_t child = 2*ind + 1; child <= 2*ind + 2; ++child) {
+                if (child < heap->size()) {
+                    frontier.push_back(child);
+                    std::push_heap(frontier.begin(), frontier.end(), before);
+                }
+            }
+            return &(*heap)[ind];
+        }
+
+    private:
+        const Container* heap;
+        Compare comp;
+        std::vector<size_t> frontier;
+    };
+
+    /**
+       The cursor type used to look ahead in a Queue.  Queues other
+       than std::priority_queue must provide a nested "cursor"
+       constructed from the queue.
+    */
+    template <typename Queue>
+    struct queue_cursor {
+        using type = typename Queue::cursor;
+    };
+    template <typename T, typename Container, typename Compare>
+    struct queue_cursor<std::priority_queue<T, Container, Compare>> {
+        using type = heap_cursor<Container, Compare>;
+    };
+
+    /**
+       A monotone radix heap queue for integral orderings.
+
+       This may replace @ref heap_queue in a merge.  It relies on the
+       fact that the merge never accepts a node ordered before the
+       last one removed.  Push is O(1) and pop-min is amortized
+       O(bits) in the bit width of the ordering type, independent of
+       queue depth.  Each node is moved between buckets at most that
+       many times.
+
+       Nodes are kept in ASCENDING ordering of the "ordering" value,
+       the Node comparison operators are not used.
+
+       Pushing a node ordered before the last node popped throws
+       std::domain_error unless the queue is empty.
+    */
+    template <typename Node>
+    class radix_queue {
+    public:
+        using value_type = Node;
+        using size_type = size_t;
+        using reference = Node&;
+        using const_reference = const Node&;
+        using ordering_t = typename node_traits<Node>::ordering_t;
+
+        static_assert(std::is_integral<ordering_t>::value,
+                      "radix_queue requires an integral ordering");
+
+        bool empty() const { return count == 0; }
+        size_type size() const { return count; }
+
+        const_reference top() const {
+            return buckets[top_bucket][top_index];
+        }
+
+        void push(const value_type& node) {
+            emplace(value_type(node));
+        }
+        void push(value_type&& node) {
+            emplace(std::move(node));
+        }
+
+        void pop() {
+            // Remove the very node top() gives, even among equals.
+            auto& from = buckets[top_bucket];
+            std::swap(from[top_index], from.back());
+            last = key(from.back());
+            from.pop_back();
+            --count;
+            if (top_bucket > 0) {
+                // Redistribute the rest of the first non-empty bucket
+                // about its minimum.  All go to lower buckets.
+                for (auto& node : from) {
+                    buckets[bucket(key(node))].push_back(std::move(node));
+                }
+                from.clear();
+            }
+            find_top();
+        }
+
+        /**
+           Remove all nodes for which pred(node) is true.
+
+           Return the number removed.  Buckets are compacted in place
+           and the remaining nodes stay where they are.
+        */
+        template <typename Pred>
+        size_type erase_if(Pred pred) {
+            size_type n = 0;
+            for (auto& b : buckets) {
+                auto end = std::remove_if(b.begin(), b.end(), pred);
+                n += b.end() - end;
+                b.erase(end, b.end());
+            }
+            count -= n;
+            if (n) {
+                find_top();
+            }
+            return n;
+        }
+
+        /**
+           Remove all nodes, keeping bucket capacity.
+        */
+        void clear() {
+            for (auto& b : buckets) {
+                b.clear();
+            }
+            count = 0;
+            top_bucket = top_index = 0;
+        }
+
+        /**
+           Visit nodes in ascending ordering without modifying the
+           queue.
+
+           Every node in a bucket precedes every node in the next so
+           each bucket is ordered only when the cursor reaches it.
+        */
+        class cursor {
+        public:
+            explicit cursor(const radix_queue& queue) : queue(&queue) {
+                load();
+            }
+
+            /// Return the next node or nullptr when exhausted.
+            const value_type* next() {
+                while (order.empty()) {
+                    if (ibucket == nbits) {
+                        return nullptr;
+                    }
+                    ++ibucket;
+                    load();
+                }
+                const auto& b = queue->buckets[ibucket];
+                std::pop_heap(order.begin(), order.end(), later(b));
+                const size_t ind = order.back();
+                order.pop_back();
+                return &b[ind];
+            }
+
+        private:
+            using bucket_t = std::vector<value_type>;
+            static auto later(const bucket_t& b) {
+                return [&b](size_t x, size_t y) { return key(b[x]) > key(b[y]); };
+            }
+            void load() {
+                const auto& b = queue->buckets[ibucket];
+                order.resize(b.size());
+                for (size_t ind = 0; ind < b.size(); ++ind) {
+                    order[ind] = ind;
+                }
+                std::make_heap(order.begin(), order.end(), later(b));
+            }
+
+            const radix_queue* queue;
+            size_t ibucket{0};
+            std::vector<size_t> order;
+        };
+
+    private:
+
+        using key_t = typename std::make_unsigned<ordering_t>::type;
+        static constexpr int nbits = std::numeric_limits<key_t>::digits;
+
+        // Map ordering to an unsigned key preserving order.
+        static key_t key(const value_type& node) {
+            key_t k = static_cast<key_t>(node_traits<Node>::ordering(node));
+            if constexpr (std::is_signed<ordering_t>::value) {
+                k ^= key_t(1) << (nbits - 1);
+            }
+            return k;
+        }
+
+        // Bucket index is the position of highest bit differing from last.
+        size_t bucket(key_t k) const {
+            key_t diff = k ^ last;
+            size_t ind = 0;
+            while (diff) {
+                ++ind;
+                diff >>= 1;
+            }
+            return ind;
+        }
+
+        void emplace(value_type&& node) {
+            const key_t k = key(node);
+            if (k < last) {
+                if (count) {
+                    throw std::domain_error("radix queue is monotone");
+                }
+                last = k;
+            }
+            const size_t b = bucket(k);
+            auto& to = buckets[b];
+            to.push_back(std::move(node));
+            ++count;
+            if (count == 1 || b < top_bucket ||
+                (b == top_bucket && k < key(top()))) {
+                top_bucket = b;
+                top_index = to.size() - 1;
+            }
+        }
+
+        // Locate the minimum node, scanning first non-empty bucket.
+        void find_top() {
+            top_bucket = top_index = 0;
+            if (!count) {
+                return;
+            }
+            while (buckets[top_bucket].empty()) {
+                ++top_bucket;
+            }
+            const auto& b = buckets[top_bucket];
+            if (top_bucket == 0) {
+                top_index = b.size() - 1;
+                return;
+            }
+            for (size_t ind = 1; ind < b.size(); ++ind) {
+                if (key(b[ind]) < key(b[top_index])) {
+                    top_index = ind;
+                }
+            }
+        }
+
+        std::array<std::vector<value_type>, nbits+1> buckets;
+        size_t count{0};
+        key_t last{0};
+        size_t top_bucket{0}, top_index{0};
+    };
+
     /**
        A k-way merge with ordering and optional latency guarantees.
 
@@ -55,21 +754,29 @@ namespace zipper {
        Note, the priority is in ASCENDING orderering, the queue inside
        merge is a min-heap.  If the reverse is true, you must provide
        a Node type with a "backwards" less-than operator.
+
+       The Queue may be replaced with one providing the interface of
+       std::priority_queue, such as @ref radix_queue for integral
+       orderings.
+
+       The Trace receives hooks at points of interest inside the
+       merge, see @ref null_trace.
     */
-    template <typename Node>
-    class merge
-        : public std::priority_queue<Node,
-                                     std::vector<Node>,
-                                     std::greater<Node>> {
+    template <typename Node,
+              typename Queue = heap_queue<Node>,
+              typename Trace = null_trace>
+    class merge : public Queue {
 
     public:
         using node_t = Node;
-        using payload_t = typename Node::payload_t;
-        using ordering_t = typename Node::ordering_t;
-        using identity_t = typename Node::identity_t;
-        using timepoint_t = typename Node::timepoint_t;
+        using traits_t = node_traits<Node>;
+        using payload_t = typename traits_t::payload_t;
+        using ordering_t = typename traits_t::ordering_t;
+        using identity_t = typename traits_t::identity_t;
+        using timepoint_t = typename traits_t::timepoint_t;
         using duration_t = typename timepoint_t::duration;
         using clock_t = typename timepoint_t::clock;
+        using trace_t = Trace;
 
         /**
            Construct a zipper merge.
@@ -77,7 +784,7 @@ namespace zipper {
            See @ref set_cardinality() for the "k" parameter.
 
            A nonzero max_latency must be supplied to enable latency
-           guaratees.
+           guaratees.  This requires a Node type with a debut.
          */
         explicit merge (size_t k=0,
                         duration_t max_latency = duration_t::zero())
@@ -85,6 +792,7 @@ namespace zipper {
             , latency(max_latency)
             , origin(0)         // ordering
         {
+            check_latency(max_latency);
         }
 
         /** 
@@ -116,15 +824,308 @@ namespace zipper {
             cardinality = k;
         }
 
+        /**
+           Register a stream with its own latency budget.
+
+           An unrepresented stream is considered stale once this much
+           time has passed since it last fed a node.  A zero budget
+           means the stream is waited on without bound.  A stream
+           which is not registered gets the max_latency given to the
+           constructor.
+
+           This may be called at any time, including to change the
+           budget of a known stream.  A registered stream is known
+           even before it feeds its first node.  Registering does not
+           change the cardinality.  A registered budget is not changed
+           by @ref adapt_latency().
+        */
+        void add_stream(const identity_t& ident, duration_t max_latency) {
+            check_latency(max_latency);
+            const auto key = group_of(ident);
+            auto& s = stream(key);
+            s.fixed = true;
+            set_latency(key, s, max_latency);
+        }
+
+        /**
+           Adapt stream latency budgets to observed arrivals.
+
+           Each stream not given its own budget with add_stream()
+           tracks the distribution of time between the debuts of its
+           nodes with a streaming quantile estimate updated by
+           feed().  A stream can only be declared stale, and so lose
+           nodes, when such a gap exceeds its budget.  Its budget is
+           set to the estimated 1 - target_loss quantile of its gaps,
+           kept within [lo, hi].
+
+           Streams, including new ones, start with budget "hi" which
+           also replaces the max_latency given to the constructor.
+           This requires a Node type with a debut.  Throws
+           std::invalid_argument for a target outside (0, 1) or
+           bounds not satisfying 0 < lo <= hi.
+        */
+        void adapt_latency(double target_loss, duration_t lo, duration_t hi) {
+            if (!(target_loss > 0 && target_loss < 1)) {
+                throw std::invalid_argument("target loss must be in (0, 1)");
+            }
+            if (!(duration_t::zero() < lo && lo <= hi)) {
+                throw std::invalid_argument("latency bounds must have 0 < lo <= hi");
+            }
+            check_latency(hi);
+            adapting = true;
+            adapt_lo = lo;
+            adapt_hi = hi;
+            adapt_q = 1 - target_loss;
+            latency = hi;
+            for (auto& [ident, s] : streams) {
+                if (!s.fixed) {
+                    s.gaps = p2_quantile(adapt_q);
+                    set_latency(ident, s, hi);
+                }
+            }
+        }
+
+        /**
+           Return the latency budget currently in effect for a known
+           stream.  Throws if the stream is not known.
+        */
+        duration_t effective_latency(const identity_t& ident) const {
+            return streams.at(group_of(ident)).latency;
+        }
+
+        /**
+           Make a stream a redundant member of a group.
+
+           Members of a group are taken to carry copies of the same
+           data, for example over redundant links, with at most one
+           node per ordering value.  The first node fed for a given
+           (group, ordering) is kept and later copies from any member
+           are discarded by feed(), which returns false for them.
+
+           For completeness, latency and @ref stats() a group counts
+           as one stream, identified by "group", which is represented
+           when any of its members is.  Cardinality counts groups and
+           ungrouped streams.  A member must be added before it feeds
+           its first node.  Throws std::logic_error otherwise.
+
+           Orderings are remembered until every member has moved past
+           them so a copy is discarded and counted as a duplicate even
+           when the first was long drained or was itself tardy.  Only
+           the last few orderings before the origin are kept though,
+           see @ref remember_drained(), so a member which falls behind
+           or stops feeding costs bounded memory.
+        */
+        void add_redundant(const identity_t& group, const identity_t& ident) {
+            if (members.count(ident)) {
+                return;
+            }
+            if (ident != group && streams.count(ident)) {
+                throw std::logic_error("redundant member has already fed");
+            }
+            auto& g = groups[group];
+            members[ident] = member_t{group, g.last.size()};
+            g.last.push_back(std::numeric_limits<ordering_t>::lowest());
+        }
+
+        /**
+           Remember at most "most" orderings before the origin per
+           group of redundant members, 4096 by default.
+
+           A copy of an ordering forgotten this way is rejected by
+           feed() as tardy rather than counted as a duplicate.
+        */
+        void remember_drained(size_t most) {
+            drained_most = most;
+        }
+
+        /// Number of copies discarded from members of a group.
+        size_t duplicates(const identity_t& group) const {
+            auto it = groups.find(group);
+            return it == groups.end() ? 0 : it->second.duplicates;
+        }
+
+        /**
+           Statistics about one stream.
+        */
+        struct stream_stats {
+            size_t occupancy;   // nodes held in the queue
+            duration_t latency; // latency budget
+            size_t stale;       // times declared stale, see declare_stale()
+        };
+
+        /**
+           Return statistics for a known stream.
+
+           Throws if the stream is not known.
+        */
+        stream_stats stats(const identity_t& ident) const {
+            const auto& s = streams.at(group_of(ident));
+            return stream_stats{s.occupancy, s.latency, s.stale};
+        }
+
         ordering_t get_origin() const { return origin; }
 
         /**
-           Clear the zipper merge buffer.
+           Raise the origin so nodes subsequently fed with ordering
+           before "ord" are rejected as tardy.
+
+           This lets an adapter which has emitted output up to "ord"
+           keep stragglers from repeating it.  A lower "ord" has no
+           effect.  Throws std::logic_error if a held node is ordered
+           before "ord".
+        */
+        void raise_origin(const ordering_t& ord) {
+            if (!(origin < ord)) {
+                return;
+            }
+            if (!this->empty() && traits_t::ordering(this->top()) < ord) {
+                throw std::logic_error("raising origin past held nodes");
+            }
+            origin = ord;
+        }
+
+        /**
+           Clear the zipper merge buffer and any late nodes.
+
+           This is linear in the number of nodes held and the queue
+           keeps its capacity for reuse.  Known streams remain known
+           and become unrepresented.  Nodes of an shm_source must
+           be cleared with its clear() to release their slots.
         */
         void clear() {
-            std::vector<node_t> got;
-            drain_full(std::back_inserter(got));
+            trace_scope<Trace> scope(probe::erase);
+            if constexpr (is_priority_queue<Queue>::value) {
+                this->c.clear();
+            }
+            else {
+                Queue::clear();
+            }
+            for (auto& [ident, s] : streams) {
+                if (s.occupancy) {
+                    s.occupancy = 0;
+                    unrepresent(ident, s);
+                }
+            }
+            for (auto& [ident, g] : groups) {
+                g.seen.clear();
+                std::fill(g.last.begin(), g.last.end(),
+                          std::numeric_limits<ordering_t>::lowest());
+            }
             origin = 0;
+            late = late_queue_t();
+        }
+
+        /**
+           Remove every held node for which pred(node) is true.
+
+           Return the number of nodes removed.  The queue is compacted
+           in place and, for the default queue, re-heapified once in
+           linear time.  Streams left with no nodes become
+           unrepresented.  The origin is not changed and late nodes
+           are not considered.  Nodes of an shm_source must be
+           erased with its erase_if() to release their slots.
+        */
+        template <typename Pred>
+        size_t erase_if(Pred pred) {
+            trace_scope<Trace> scope(probe::erase);
+            auto doomed = [&](const node_t& node) {
+                if (!pred(node)) {
+                    return false;
+                }
+                const auto& ident = group_of(traits_t::identity(node));
+                auto& s = streams.at(ident);
+                s.occupancy -= 1;
+                if (s.occupancy == 0) {
+                    unrepresent(ident, s);
+                }
+                return true;
+            };
+            if constexpr (is_priority_queue<Queue>::value) {
+                auto& c = this->c;
+                auto end = std::remove_if(c.begin(), c.end(), doomed);
+                const size_t n = c.end() - end;
+                if (n) {
+                    c.erase(end, c.end());
+                    std::make_heap(c.begin(), c.end(), this->comp);
+                }
+                return n;
+            }
+            else {
+                return Queue::erase_if(doomed);
+            }
+        }
+
+        /**
+           Remove every held node ordered before "ord".
+        */
+        size_t erase_before(const ordering_t& ord) {
+            return erase_if([&](const node_t& node) {
+                return traits_t::ordering(node) < ord;
+            });
+        }
+
+        /**
+           Remove every held node from the identified stream.
+
+           The stream remains known.  Given a group or any of its
+           redundant members, nodes from all members are removed.
+        */
+        size_t erase_stream(const identity_t& ident) {
+            const auto& group = group_of(ident);
+            auto it = streams.find(group);
+            if (it == streams.end() || it->second.occupancy == 0) {
+                return 0;
+            }
+            return erase_if([&](const node_t& node) {
+                return group_of(traits_t::identity(node)) == group;
+            });
+        }
+
+        /**
+           A node rejected by feed() and how far it was behind origin.
+        */
+        struct late_node {
+            node_t node;
+            ordering_t lateness;
+        };
+
+        /**
+           Keep nodes rejected as tardy instead of losing them.
+
+           Up to "most" rejected nodes are held in a separate buffer,
+           ordered like the merge, until taken with drain_late().
+           Beyond that they are counted and lost.  A zero "most",
+           which is the default, keeps none.
+
+           Late nodes do not take part in completeness and feed()
+           still returns false for them.
+
+           With an shm_source, late nodes point into ring slots which
+           the source holds until each is given to its release().
+        */
+        void keep_late(size_t most = std::numeric_limits<size_t>::max()) {
+            late_most = most;
+        }
+
+        /// Number of late nodes held.
+        size_t late_size() const { return late.size(); }
+
+        /// Number of late nodes lost for lack of room.
+        size_t late_lost() const { return late_overflow; }
+
+        /**
+           Return all held late nodes in ascending ordering as @ref
+           late_node.
+        */
+        template<typename OutputIterator>
+        OutputIterator drain_late(OutputIterator result)
+        {
+            while (!late.empty()) {
+                *result = late.top(); // hey, dev: do not forget back_inserter
+                ++result;
+                late.pop();
+            }
+            return result;
         }
 
         /**
@@ -132,16 +1133,35 @@ namespace zipper {
 
            Return true if it was accepted.  Rejection will occur if
            the node partial ordering places it "earlier" (smaller
-           ordering value) than the last drained node.
+           ordering value) than the last drained node or if it is a
+           redundant copy, see @ref add_redundant().
         */
         bool feed(const node_t& node) {
-            if (node.ordering < origin) {
+            trace_scope<Trace> scope(probe::feed);
+            if (!members.empty() && !first_copy(node)) {
+                Trace::reject(node);
+                return false;
+            }
+            if (traits_t::ordering(node) < origin) {
+                Trace::reject(node);
+                if (late_most) {
+                    keep(node);
+                }
                 return false;
             }
-            auto& s = streams[node.identity];
+            auto& s = stream(group_of(traits_t::identity(node)));
+            if (s.occupancy == 0) {
+                waiting.erase(s.waiting);
+            }
             s.occupancy += 1;
-            s.last_seen = node.debut;
+            if constexpr (traits_t::has_debut) {
+                if (adapting && !s.fixed) {
+                    adapt(s, traits_t::debut(node));
+                }
+                s.last_seen = traits_t::debut(node);
+            }
             this->push(node);
+            Trace::accept(node);
             return true;
         }
 
@@ -153,7 +1173,26 @@ namespace zipper {
                   const identity_t& ident,
                   const timepoint_t& debut = clock_t::now() )
         {
-            return feed(node_t{pay, ord, ident, debut});
+            return feed(traits_t::make(pay, ord, ident, debut));
+        }
+
+        /**
+           Feed a batch of nodes, stamping each with a common debut.
+
+           This reads the clock once per batch instead of once per
+           node.  Return the number of nodes accepted.
+        */
+        template<typename InputIterator>
+        size_t feed_batch(InputIterator first, InputIterator last,
+                          const timepoint_t& debut = clock_t::now())
+        {
+            size_t naccepted = 0;
+            for (; first != last; ++first) {
+                node_t node = *first;
+                traits_t::set_debut(node, debut);
+                naccepted += feed(node);
+            }
+            return naccepted;
         }
 
         /** Unconditionally pop and return the top node.
@@ -167,12 +1206,18 @@ namespace zipper {
             if (this->empty()) {
                 throw std::out_of_range("attempt to drain empty queue");
             }
+            trace_scope<Trace> scope(probe::next);
             auto node = this->top(); // copy
             this->pop();
+            Trace::pop(node);
 
-            auto& s = streams.at(node.identity);
+            const auto& ident = group_of(traits_t::identity(node));
+            auto& s = streams.at(ident);
             s.occupancy -= 1;
-            origin = node.ordering;
+            if (s.occupancy == 0) {
+                unrepresent(ident, s);
+            }
+            origin = traits_t::ordering(node);
 
             return node;
         }
@@ -183,6 +1228,7 @@ namespace zipper {
         template<typename OutputIterator>
         OutputIterator drain_full(OutputIterator result)
         {
+            trace_scope<Trace> scope(probe::drain_full);
             while (!this->empty()) {
                 *result = next(); // hey, dev: do not forget back_inserter
                 ++result;
@@ -203,7 +1249,9 @@ namespace zipper {
         OutputIterator drain_prompt(OutputIterator result,
                                     const timepoint_t& now = clock_t::now())
         {
+            trace_scope<Trace> scope(probe::drain_prompt);
             while (complete(now)) {
+                declare_stale(now);
                 *result = next(); // hey, dev: do not forget back_inserter
                 ++result;
             }
@@ -219,6 +1267,7 @@ namespace zipper {
         template<typename OutputIterator>
         OutputIterator drain_waiting(OutputIterator result)
         {
+            trace_scope<Trace> scope(probe::drain_waiting);
             while (complete()) {
                 *result = next(); // hey, dev: do not forget back_inserter
                 ++result;
@@ -226,6 +1275,79 @@ namespace zipper {
             return result;
         }
 
+        /**
+           Limits on the work done by one budgeted drain call.
+
+           At most "most" nodes are drained.  Draining also stops
+           once the clock of the merge reaches "until".  The clock is
+           read only once per @ref budget_check_period nodes so a call
+           may overrun "until" by that many nodes.
+        */
+        struct drain_budget {
+            size_t most{std::numeric_limits<size_t>::max()};
+            timepoint_t until{timepoint_t::max()};
+        };
+
+        /// Number of nodes drained between reads of the clock.
+        static constexpr size_t budget_check_period = 64;
+
+        /**
+           The result of a budgeted drain.
+
+           When "more" is true the budget ran out while the queue was
+           still complete and calling again will continue the drain.
+           Completeness is kept incrementally by the merge so
+           resuming does not rescan streams.
+        */
+        template<typename OutputIterator>
+        struct drained {
+            OutputIterator result;
+            size_t count;
+            bool more;
+        };
+
+        /**
+           Like @ref drain_prompt() but stop when the budget is spent.
+        */
+        template<typename OutputIterator>
+        drained<OutputIterator> drain_prompt(OutputIterator result,
+                                             const timepoint_t& now,
+                                             const drain_budget& budget)
+        {
+            trace_scope<Trace> scope(probe::drain_prompt);
+            size_t count = 0;
+            while (complete(now)) {
+                if (spent(budget, count)) {
+                    return {result, count, true};
+                }
+                declare_stale(now);
+                *result = next(); // hey, dev: do not forget back_inserter
+                ++result;
+                ++count;
+            }
+            return {result, count, false};
+        }
+
+        /**
+           Like @ref drain_waiting() but stop when the budget is spent.
+        */
+        template<typename OutputIterator>
+        drained<OutputIterator> drain_waiting(OutputIterator result,
+                                              const drain_budget& budget)
+        {
+            trace_scope<Trace> scope(probe::drain_waiting);
+            size_t count = 0;
+            while (complete()) {
+                if (spent(budget, count)) {
+                    return {result, count, true};
+                }
+                *result = next(); // hey, dev: do not forget back_inserter
+                ++result;
+                ++count;
+            }
+            return {result, count, false};
+        }
+
 
         /**
            Return the next top node without removal.
@@ -239,6 +1361,80 @@ namespace zipper {
             return this->top();
         }
 
+        using cursor_t = typename queue_cursor<Queue>::type;
+
+        /**
+           A bounded, single-pass view of held nodes in ascending
+           ordering, see @ref lookahead().
+        */
+        class lookahead_view {
+        public:
+            class iterator {
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using value_type = node_t;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const node_t*;
+                using reference = const node_t&;
+
+                iterator(lookahead_view* view, pointer node)
+                    : view(view), node(node) {}
+                reference operator*() const { return *node; }
+                pointer operator->() const { return node; }
+                iterator& operator++() {
+                    node = view->advance();
+                    return *this;
+                }
+                bool operator==(const iterator& rhs) const { return node == rhs.node; }
+                bool operator!=(const iterator& rhs) const { return node != rhs.node; }
+            private:
+                lookahead_view* view;
+                pointer node;
+            };
+
+            lookahead_view(cursor_t cur, size_t most)
+                : cur(std::move(cur)), left(most) {}
+
+            /// Begin the pass, call once.
+            iterator begin() { return iterator(this, advance()); }
+            iterator end() { return iterator(this, nullptr); }
+
+        private:
+            const node_t* advance() {
+                if (!left) {
+                    return nullptr;
+                }
+                --left;
+                return cur.next();
+            }
+            cursor_t cur;
+            size_t left;
+        };
+
+        /**
+           Look ahead at up to "most" held nodes in ascending
+           ordering without removing them.
+
+           Neither the queue nor the origin are changed and nodes are
+           not copied.  Visiting m nodes costs O(m log m) for the
+           default queue.  Among nodes of equal ordering the order
+           may differ from that of draining.
+
+           The view is invalid once the merge is modified.
+
+           @code
+           for (const auto& node : mq.lookahead(8)) { ... }
+           @endcode
+        */
+        lookahead_view lookahead(size_t most = std::numeric_limits<size_t>::max()) const {
+            if constexpr (is_priority_queue<Queue>::value) {
+                return lookahead_view(cursor_t(this->c, this->comp), most);
+            }
+            else {
+                return lookahead_view(cursor_t(static_cast<const Queue&>(*this)), most);
+            }
+        }
+
         /**
            Return true if queue is "complete".
 
@@ -252,73 +1448,608 @@ namespace zipper {
            stream which is absent (never yet seen).
          */
         bool complete(const timepoint_t& now = timepoint_t::min()) const {
-            if (this->empty()) {
-                return false;
-            }
+            trace_scope<Trace> scope(probe::complete);
+            const bool ok = !this->empty() && covered(now, &group_of(traits_t::identity(this->top())));
+            Trace::decide(ok);
+            return ok;
+        }
+
+        /**
+           Return true if queue is "settled".
 
-            const size_t target_cardinality = streams.size();
+           This is like @ref complete() except that the top node also
+           counts toward representing its stream and an empty queue
+           may be settled if all known streams are stale.
 
-            if (target_cardinality < cardinality) { // absent streams
-                if (latency == duration_t::zero()) { // unbound latency
-                    return false;
+           When settled, no node subsequently fed by a represented
+           stream can be ordered before any node currently held.
+           Only stale or absent streams may yet provide such nodes.
+         */
+        bool settled(const timepoint_t& now = timepoint_t::min()) const {
+            return covered(now, nullptr);
+        }
+
+        /**
+           Declare unrepresented streams which are stale at "now".
+
+           Each is counted in @ref stats() and traced once per time
+           it becomes unrepresented.  The prompt drains call this as
+           they drain past stale streams.  An adapter which drains
+           with next() once complete(now), or emits once
+           settled(now), should call it first to do the same.
+        */
+        void declare_stale(const timepoint_t& now) {
+            if (waiting.empty() || undeclared.empty()) {
+                return;
+            }
+            auto keep = undeclared.begin();
+            for (const auto& ident : undeclared) {
+                auto& s = streams.at(ident);
+                if (s.occupancy == 0 && !s.declared && !stale(due(s), now)) {
+                    *keep++ = ident; // not yet
+                    continue;
+                }
+                s.pending = false;
+                if (s.occupancy == 0 && !s.declared) {
+                    s.declared = true;
+                    ++s.stale;
+                    Trace::stale(ident);
                 }
             }
+            undeclared.erase(keep, undeclared.end());
+        }
 
-            size_t completeness = 0;
+        /**
+           Return the time at which the queue becomes complete as
+           streams go stale, absent any new input.
+
+           This is the minimal time if the queue is complete without
+           regard to staleness and the maximal time if staleness
+           alone can not make it complete, such as when it is empty
+           or a blocking stream has unbound latency.
 
-            const auto top_ident = this->top().identity;
+           The cost does not depend on the number of streams.
+        */
+        timepoint_t deadline() const {
+            if (this->empty()) {
+                return timepoint_t::max();
+            }
+            if (streams.size() < cardinality && latency == duration_t::zero()) {
+                return timepoint_t::max();
+            }
+            timepoint_t when = timepoint_t::min();
+            if (!waiting.empty()) {
+                when = waiting.rbegin()->first;
+            }
+            const auto& s = streams.at(group_of(traits_t::identity(this->top())));
+            if (s.occupancy == 1) {
+                when = std::max(when, due(s));
+            }
+            return when;
+        }
 
-            // check each known stream to see if it is "represented"
-            for (const auto& sit : streams) {
-                const auto& ident = sit.first;
-                auto have = sit.second.occupancy;
+    private:
 
-                // Do not count the top node.
-                if (top_ident == ident) {
-                    have -= 1;
-                }
-                if (have > 0) {
-                    ++completeness;
-                    continue;   // stream is represented
-                }
+        // Return true if every known stream has a node, not counting
+        // one from the stream "skip" if given, or is stale.
+        //
+        // Unrepresented streams are kept in "waiting" ordered by the
+        // time they go stale so this need not visit every stream.
+        bool covered(const timepoint_t& now, const identity_t* skip) const {
 
-                // unbound latency, we wait as long as we need.
-                if (latency == duration_t::zero()) {
+            if (streams.size() < cardinality) { // absent streams
+                if (latency == duration_t::zero()) { // unbound latency
                     return false;
                 }
+            }
+
+            // the last unrepresented stream to go stale
+            if (!waiting.empty() && !stale(waiting.rbegin()->first, now)) {
+                return false;
+            }
 
-                // only observe latency guarantees given non-minimal time.
-                if (now == timepoint_t::min()) {
+            // Do not count the top node.
+            if (skip) {
+                const auto& s = streams.at(*skip);
+                if (s.occupancy == 1 && !stale(due(s), now)) {
                     return false;
                 }
+            }
+            return true;
+        }
 
-                // we are observing latency guarantees
-                const auto& last_seen = sit.second.last_seen;
-                auto delta = now - last_seen;
-                auto delta_us =
-                    std::chrono::duration_cast<std::chrono::microseconds> (delta);
-                if (delta < latency) {
-                    return false;
+        // Return true if a drain which has produced "count" nodes
+        // has spent its budget.
+        static bool spent(const drain_budget& budget, size_t count) {
+            if (count >= budget.most) {
+                return true;
+            }
+            return budget.until != timepoint_t::max()
+                && count && count % budget_check_period == 0
+                && clock_t::now() >= budget.until;
+        }
+
+        void keep(const node_t& node) {
+            if (late.size() >= late_most) {
+                ++late_overflow;
+                return;
+            }
+            late.push(late_node{node, origin - traits_t::ordering(node)});
+        }
+
+        static void check_latency(const duration_t& max_latency) {
+            if constexpr (!traits_t::has_debut) {
+                if (max_latency != duration_t::zero()) {
+                    throw std::invalid_argument("latency bound needs nodes with a debut");
                 }
+            }
+        }
+
+        // Return true if a stream due at the given deadline is stale.
+        // Time must be non-minimal to observe latency guarantees.
+        static bool stale(const timepoint_t& deadline, const timepoint_t& now) {
+            return deadline != timepoint_t::max() && deadline <= now;
+        }
+
+        struct Stream;
 
-                // To preserve max latency we will not consider this
-                // stale "unrepresented" to cause incompleteness.
-                ++completeness;
+        // The time at which the stream, if unrepresented, goes stale.
+        timepoint_t due(const Stream& s) const {
+            if (s.latency == duration_t::zero()) { // unbound latency
+                return timepoint_t::max();
             }
+            if (s.last_seen == timepoint_t::min()) { // absent
+                return timepoint_t::min();
+            }
+            return s.last_seen + s.latency;
+        }
 
-            return completeness >= target_cardinality;
+        // The identity under which a stream is tracked, its group if
+        // it is a redundant member.
+        const identity_t& group_of(const identity_t& ident) const {
+            if (members.empty()) {
+                return ident;
+            }
+            auto it = members.find(ident);
+            return it == members.end() ? ident : it->second.group;
+        }
+
+        // Return false if the node is a copy of one already fed by a
+        // member of its group.  Otherwise remember its ordering.
+        bool first_copy(const node_t& node) {
+            auto mit = members.find(traits_t::identity(node));
+            if (mit == members.end()) {
+                return true;
+            }
+            auto& g = groups.at(mit->second.group);
+            const auto& ord = traits_t::ordering(node);
+            auto& last = g.last[mit->second.index];
+            last = std::max(last, ord);
+
+            auto pos = std::lower_bound(g.seen.begin(), g.seen.end(), ord);
+            if (pos != g.seen.end() && *pos == ord) {
+                ++g.duplicates;
+                return false;
+            }
+            g.seen.insert(pos, ord); // usually at the back
+
+            // Forget what no member can still copy and old drained
+            // orderings a lagging member would yet copy.
+            const auto floor = *std::min_element(g.last.begin(), g.last.end());
+            while (!g.seen.empty() && g.seen.front() <= floor) {
+                g.seen.pop_front();
+            }
+            size_t ndrained = std::lower_bound(g.seen.begin(), g.seen.end(), origin)
+                - g.seen.begin();
+            for (; ndrained > drained_most; --ndrained) {
+                g.seen.pop_front();
+            }
+            return true;
+        }
+
+        // Learn from the gap since the stream last fed.  The stream
+        // is represented so its budget may change freely.
+        void adapt(Stream& s, const timepoint_t& debut) {
+            if (s.last_seen == timepoint_t::min() || debut < s.last_seen) {
+                return;
+            }
+            s.gaps.add((debut - s.last_seen).count());
+            if (s.gaps.count() < adapt_min_samples) {
+                return;
+            }
+            const auto want = duration_t(static_cast<typename duration_t::rep>(
+                                             std::ceil(s.gaps.value())));
+            s.latency = std::min(adapt_hi, std::max(adapt_lo, want));
+        }
+
+        // Change the budget of a stream, rekeying it if waiting.
+        void set_latency(const identity_t& ident, Stream& s, duration_t budget) {
+            s.latency = budget;
+            if (s.occupancy == 0) {
+                waiting.erase(s.waiting);
+                s.waiting = waiting.emplace(due(s), ident);
+            }
+        }
+
+        // Find or make stream, new streams are unrepresented.
+        Stream& stream(const identity_t& ident) {
+            auto it = streams.find(ident);
+            if (it != streams.end()) {
+                return it->second;
+            }
+            auto& s = streams[ident];
+            s.latency = latency;
+            if (adapting) {
+                s.gaps = p2_quantile(adapt_q);
+            }
+            unrepresent(ident, s);
+            return s;
+        }
+
+        void unrepresent(const identity_t& ident, Stream& s) {
+            s.waiting = waiting.emplace(due(s), ident);
+            s.declared = false;
+            if (!s.pending) {
+                s.pending = true;
+                undeclared.push_back(ident);
+            }
         }
 
-    private:
-        
         size_t cardinality;
-        const duration_t latency{0};
+        duration_t latency{0};
         ordering_t origin;
+        using waiting_t = std::multimap<timepoint_t, identity_t>;
         struct Stream {
             size_t occupancy{0};
-            timepoint_t last_seen{duration_t::min()};
+            timepoint_t last_seen{timepoint_t::min()};
+            duration_t latency{0};
+            size_t stale{0};
+            bool declared{false}, pending{false};
+            bool fixed{false};  // budget given by add_stream()
+            p2_quantile gaps;   // between debuts, when adapting
+            typename waiting_t::iterator waiting;
         };
         std::unordered_map<identity_t, Stream> streams;
+
+        // Samples needed before a stream budget adapts.
+        static constexpr size_t adapt_min_samples = 16;
+        bool adapting{false};
+        duration_t adapt_lo{0}, adapt_hi{0};
+        double adapt_q{1};
+
+        struct member_t {
+            identity_t group;
+            size_t index;       // into Group::last
+        };
+        struct Group {
+            std::vector<ordering_t> last; // highest fed per member
+            std::deque<ordering_t> seen;  // ascending, yet to be copied
+            size_t duplicates{0};
+        };
+        std::unordered_map<identity_t, member_t> members;
+        std::unordered_map<identity_t, Group> groups;
+        size_t drained_most{4096};
+        waiting_t waiting;
+        std::vector<identity_t> undeclared;
+
+        struct late_order {
+            bool operator()(const late_node& a, const late_node& b) const {
+                return traits_t::ordering(a.node) > traits_t::ordering(b.node);
+            }
+        };
+        using late_queue_t = std::priority_queue<late_node,
+                                                 std::vector<late_node>,
+                                                 late_order>;
+        late_queue_t late;
+        size_t late_most{0}, late_overflow{0};
+    };
+
+    /**
+       Drain a merge in batches of nodes grouped by ordering window.
+
+       With a nonzero width W, a window holds all nodes with ordering
+       in [t, t+W) where t is a multiple of W.  With zero width, a
+       window holds all nodes sharing one ordering value.
+
+       A window is emitted only once it is closed, that is, once no
+       node can still arrive in it.  This is when the merge has moved
+       past the window and is @ref merge::settled(), either because
+       all streams are represented beyond the window or because the
+       laggards are stale as judged by the latency bound.
+
+       Nodes are removed from the merge as they become complete and
+       are held in a contiguous buffer until their window closes.
+       Once a window is emitted the merge origin is raised to its end
+       so that a node later fed into it, say from a stream which was
+       stale, is rejected as tardy rather than emitted again.
+       Emission is by calling a function like:
+
+         emit(const ordering_t& lo, const node_t* first, const node_t* last)
+
+       where "lo" is the start of the window.  The span is valid only
+       during the call.
+    */
+    template <typename Merge>
+    class window {
+    public:
+        using merge_t = Merge;
+        using node_t = typename Merge::node_t;
+        using traits_t = typename Merge::traits_t;
+        using ordering_t = typename Merge::ordering_t;
+        using timepoint_t = typename Merge::timepoint_t;
+        using clock_t = typename Merge::clock_t;
+
+        explicit window(merge_t& m, ordering_t width = ordering_t{})
+            : mq(m)
+            , width(width)
+        {
+        }
+
+        /// Number of nodes removed from the merge but not yet emitted.
+        size_t pending() const { return batch.size(); }
+
+        /**
+           Emit closed windows, maintaining latency guarantee.
+
+           Return the number of windows emitted.
+        */
+        template<typename Emit>
+        size_t drain_prompt(Emit emit, const timepoint_t& now = clock_t::now())
+        {
+            return drain(emit, now, true);
+        }
+
+        /**
+           Emit closed windows, maintaining completeness.
+
+           Return the number of windows emitted.
+        */
+        template<typename Emit>
+        size_t drain_waiting(Emit emit)
+        {
+            return drain(emit, timepoint_t::min(), false);
+        }
+
+        /**
+           Emit all windows, unconditionally, including the last,
+           possibly still open, window.
+
+           Return the number of windows emitted.
+        */
+        template<typename Emit>
+        size_t drain_full(Emit emit)
+        {
+            size_t nemitted = 0;
+            while (!mq.empty()) {
+                if (!batch.empty() && !inside(traits_t::ordering(mq.peek()))) {
+                    nemitted += flush(emit);
+                }
+                push(mq.next());
+            }
+            return nemitted + flush(emit);
+        }
+
+    private:
+
+        // Stale streams are declared as by the merge's own drains.
+        template<typename Emit>
+        size_t drain(Emit& emit, const timepoint_t& now, bool prompt)
+        {
+            size_t nemitted = 0;
+            while (true) {
+                if (mq.empty()) {
+                    if (!batch.empty() && mq.settled(now)) {
+                        if (prompt) {
+                            mq.declare_stale(now);
+                        }
+                        nemitted += flush(emit);
+                    }
+                    break;
+                }
+                if (!batch.empty() && !inside(traits_t::ordering(mq.peek()))) {
+                    if (!mq.settled(now)) {
+                        break;
+                    }
+                    if (prompt) {
+                        mq.declare_stale(now);
+                    }
+                    nemitted += flush(emit);
+                    continue;
+                }
+                if (!mq.complete(now)) {
+                    break;
+                }
+                if (prompt) {
+                    mq.declare_stale(now);
+                }
+                push(mq.next());
+            }
+            return nemitted;
+        }
+
+        void push(node_t&& node)
+        {
+            if (batch.empty()) {
+                lo = floor(traits_t::ordering(node));
+            }
+            batch.push_back(std::move(node));
+        }
+
+        template<typename Emit>
+        size_t flush(Emit& emit)
+        {
+            if (batch.empty()) {
+                return 0;
+            }
+            emit(lo, batch.data(), batch.data() + batch.size());
+            batch.clear();      // keeps capacity
+            mq.raise_origin(end());
+            return 1;
+        }
+
+        // First ordering past the current window.
+        ordering_t end() const
+        {
+            if (width != ordering_t{}) {
+                return lo + width;
+            }
+            if constexpr (std::is_integral<ordering_t>::value) {
+                return lo + 1;
+            }
+            else {
+                return std::nextafter(lo, std::numeric_limits<ordering_t>::infinity());
+            }
+        }
+
+        // Start of window holding the ordering.
+        ordering_t floor(const ordering_t& ord) const
+        {
+            if (width == ordering_t{}) {
+                return ord;
+            }
+            if constexpr (std::is_integral<ordering_t>::value) {
+                ordering_t rem = ord % width;
+                if constexpr (std::is_signed<ordering_t>::value) {
+                    if (rem < 0) {
+                        rem += width;
+                    }
+                }
+                return ord - rem;
+            }
+            else {
+                return std::floor(ord / width) * width;
+            }
+        }
+
+        bool inside(const ordering_t& ord) const
+        {
+            if (width == ordering_t{}) {
+                return ord == lo;
+            }
+            return ord < lo + width;
+        }
+
+        merge_t& mq;
+        const ordering_t width;
+        ordering_t lo{};
+        std::vector<node_t> batch;
+    };
+
+    /**
+       Drain a merge as a join, one tuple per ordering value.
+
+       A join has a fixed set of stream identities, each given a slot
+       by its position.  For each ordering value a tuple holds the
+       node from each stream with that ordering.  A slot for which no
+       such node exists is "absent" and given as nullptr.  This is
+       the case when a stream has no node at that ordering or when
+       it was stale when the tuple closed.
+
+       Tuples are closed as are windows of zero width, see @ref
+       window, so each ordering value gives at most one tuple and a
+       node later fed for an emitted ordering is rejected as tardy.
+       The merge cardinality should count the joined streams.
+
+       Emission is by calling a function like:
+
+         emit(const ordering_t& ord, const node_t* const* first, const node_t* const* last)
+
+       with one slot per identity in the order given to the
+       constructor.  The span is valid only during the call.  Slot
+       storage is allocated once and batch storage is reused so
+       steady state emission does not allocate.
+
+       A node from an identity which is not joined, or a second node
+       from a stream at the same ordering, is not placed in a tuple
+       but is counted, see @ref unjoined().
+    */
+    template <typename Merge>
+    class join {
+    public:
+        using merge_t = Merge;
+        using node_t = typename Merge::node_t;
+        using traits_t = typename Merge::traits_t;
+        using ordering_t = typename Merge::ordering_t;
+        using identity_t = typename Merge::identity_t;
+        using timepoint_t = typename Merge::timepoint_t;
+        using clock_t = typename Merge::clock_t;
+
+        join(merge_t& m, const std::vector<identity_t>& idents)
+            : win(m)
+            , slots(idents.size(), nullptr)
+        {
+            for (size_t ind = 0; ind < idents.size(); ++ind) {
+                index[idents[ind]] = ind;
+            }
+        }
+
+        /// Number of slots in each tuple.
+        size_t arity() const { return slots.size(); }
+
+        /// Number of nodes not placed in any tuple.
+        size_t unjoined() const { return nunjoined; }
+
+        /// Number of nodes removed from the merge but not yet emitted.
+        size_t pending() const { return win.pending(); }
+
+        /**
+           Emit closed tuples, maintaining latency guarantee.
+
+           Return the number of tuples emitted.
+        */
+        template<typename Emit>
+        size_t drain_prompt(Emit emit, const timepoint_t& now = clock_t::now())
+        {
+            return win.drain_prompt(tuple(emit), now);
+        }
+
+        /**
+           Emit closed tuples, maintaining completeness.
+
+           Return the number of tuples emitted.
+        */
+        template<typename Emit>
+        size_t drain_waiting(Emit emit)
+        {
+            return win.drain_waiting(tuple(emit));
+        }
+
+        /**
+           Emit all tuples, unconditionally.
+
+           Return the number of tuples emitted.
+        */
+        template<typename Emit>
+        size_t drain_full(Emit emit)
+        {
+            return win.drain_full(tuple(emit));
+        }
+
+    private:
+
+        // Adapt a tuple emitter to a window emitter.
+        template<typename Emit>
+        auto tuple(Emit& emit)
+        {
+            return [this, &emit](const ordering_t& ord,
+                                 const node_t* first, const node_t* last) {
+                std::fill(slots.begin(), slots.end(), nullptr);
+                for (; first != last; ++first) {
+                    auto it = index.find(traits_t::identity(*first));
+                    if (it == index.end() || slots[it->second]) {
+                        ++nunjoined;
+                        continue;
+                    }
+                    slots[it->second] = first;
+                }
+                emit(ord, slots.data(), slots.data() + slots.size());
+            };
+        }
+
+        window<Merge> win;
+        std::unordered_map<identity_t, size_t> index;
+        std::vector<const node_t*> slots;
+        size_t nunjoined{0};
     };
 
 }
@@ -0,0 +1,244 @@
+#ifndef ZIPPER_BROADCAST_HPP
+#define ZIPPER_BROADCAST_HPP
+
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <limits>
+#include <iterator>
+#include <stdexcept>
+
+namespace zipper {
+
+    /**
+       Fan out one stream of values to several consumers.
+
+       A single producer writes into a ring of fixed capacity.  Each
+       value is stored once and each of a fixed number of consumers
+       reads every value in place, in order, through its own cursor.
+       Consumers never wait for the producer or each other and with
+       the block policy the producer never waits either.
+
+       When the slowest consumer is a full ring behind, the policy
+       decides:
+
+       - block :: push() refuses the value (backpressure).
+
+       - drop :: the oldest value is discarded for consumers which
+         have not yet read it and is counted in their stats.  As
+         values are read in place, push() must then wait for any
+         consumer still reading the oldest value, so the producer is
+         not lock-free and a slow f() given to consume() slows it.
+
+       Typical use is to drain a merge into it with inserter().
+    */
+    template <typename T>
+    class broadcast {
+    public:
+        using value_type = T;
+
+        enum class policy { block, drop };
+
+        struct consumer_stats {
+            size_t lag;         // values written but not yet read
+            size_t consumed;    // values read
+            size_t dropped;     // values skipped by the producer
+        };
+
+        /**
+           Create with room for at least "capacity" values, which is
+           rounded up to a power of two, and "nconsumers" consumers
+           numbered from zero.
+        */
+        broadcast(size_t capacity, size_t nconsumers,
+                  policy pol = policy::block)
+            : mask(round_up(capacity) - 1)
+            , slots(mask + 1)
+            , consumers(nconsumers)
+            , pol(pol)
+        {
+        }
+
+        size_t capacity() const { return mask + 1; }
+        size_t size() const { return consumers.size(); }
+
+        /**
+           Producer: append a value.
+
+           Return false if the ring is full and policy is block.
+        */
+        bool push(const value_type& val) {
+            return emplace(val);
+        }
+        bool push(value_type&& val) {
+            return emplace(std::move(val));
+        }
+
+        /**
+           Producer: an output iterator which pushes and which, with
+           the block policy, waits for room.
+        */
+        class insert_iterator {
+        public:
+            using iterator_category = std::output_iterator_tag;
+            using value_type = void;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = void;
+
+            explicit insert_iterator(broadcast& b) : bc(&b) {}
+            insert_iterator& operator=(const T& val) {
+                while (!bc->push(val)) {
+                    std::this_thread::yield();
+                }
+                return *this;
+            }
+            insert_iterator& operator=(T&& val) {
+                while (!bc->push(std::move(val))) { // moves only on success
+                    std::this_thread::yield();
+                }
+                return *this;
+            }
+            insert_iterator& operator*() { return *this; }
+            insert_iterator& operator++() { return *this; }
+            insert_iterator& operator++(int) { return *this; }
+        private:
+            broadcast* bc;
+        };
+        insert_iterator inserter() { return insert_iterator(*this); }
+
+        /**
+           Consumer: call f(const T&) on up to "most" available values
+           in place, in order.  Return the number consumed.
+        */
+        template<typename Func>
+        size_t consume(size_t which, Func f,
+                       size_t most = std::numeric_limits<size_t>::max())
+        {
+            auto& con = consumers.at(which);
+            size_t num = 0;
+            while (num < most) {
+                const size_t cur = con.cursor.load(std::memory_order_acquire);
+                if (cur == head.load(std::memory_order_acquire)) {
+                    break;
+                }
+                if (pol == policy::drop) {
+                    // Announce the read and check the producer has
+                    // not since skipped us past this slot.
+                    con.reading.store(cur);
+                    if (con.cursor.load() != cur) {
+                        con.reading.store(none); // else reclaim() waits on it
+                        continue;
+                    }
+                }
+                f(static_cast<const T&>(slots[cur & mask]));
+                if (pol == policy::drop) {
+                    con.reading.store(none);
+                    size_t expect = cur;
+                    if (!con.cursor.compare_exchange_strong(expect, cur + 1)) {
+                        // skipped while read: delivered after all
+                        con.dropped.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                }
+                else {
+                    con.cursor.store(cur + 1, std::memory_order_release);
+                }
+                con.consumed.fetch_add(1, std::memory_order_relaxed);
+                ++num;
+            }
+            return num;
+        }
+
+        /**
+           Consumer: copy out the next value if there is one.
+        */
+        bool pop(size_t which, T& val) {
+            return consume(which, [&](const T& v) { val = v; }, 1) == 1;
+        }
+
+        /// Current lag and counts of a consumer.
+        consumer_stats stats(size_t which) const {
+            const auto& con = consumers.at(which);
+            const size_t cur = con.cursor.load(std::memory_order_acquire);
+            const size_t h = head.load(std::memory_order_acquire);
+            return consumer_stats{
+                h > cur ? h - cur : 0,
+                con.consumed.load(std::memory_order_relaxed),
+                con.dropped.load(std::memory_order_relaxed)};
+        }
+
+    private:
+
+        static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+        static size_t round_up(size_t n) {
+            if (n == 0) {
+                throw std::invalid_argument("broadcast needs nonzero capacity");
+            }
+            size_t p = 1;
+            while (p < n) {
+                p <<= 1;
+            }
+            return p;
+        }
+
+        template<typename V>
+        bool emplace(V&& val) {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h - floor > mask) {
+                floor = slowest(h);
+                if (h - floor > mask) {
+                    if (pol == policy::block) {
+                        return false;
+                    }
+                    reclaim(h - mask - 1);
+                    floor = h - mask;
+                }
+            }
+            slots[h & mask] = std::forward<V>(val);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t slowest(size_t h) const {
+            size_t low = h;
+            for (const auto& con : consumers) {
+                low = std::min(low, con.cursor.load(std::memory_order_acquire));
+            }
+            return low;
+        }
+
+        // Skip consumers still at the oldest slot, waiting out any
+        // read of it in progress.
+        void reclaim(size_t oldest) {
+            for (auto& con : consumers) {
+                size_t expect = oldest;
+                if (!con.cursor.compare_exchange_strong(expect, oldest + 1)) {
+                    continue;
+                }
+                con.dropped.fetch_add(1, std::memory_order_relaxed);
+                while (con.reading.load() == oldest) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        struct alignas(64) consumer {
+            std::atomic<size_t> cursor{0};
+            std::atomic<size_t> reading{none};
+            std::atomic<size_t> consumed{0};
+            std::atomic<size_t> dropped{0};
+        };
+
+        const size_t mask;
+        std::vector<T> slots;
+        std::vector<consumer> consumers;
+        const policy pol;
+
+        alignas(64) std::atomic<size_t> head{0};
+        size_t floor{0};        // producer's cache of slowest cursor
+    };
+}
+#endif
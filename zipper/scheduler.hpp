@@ -0,0 +1,384 @@
+#ifndef ZIPPER_SCHEDULER_HPP
+#define ZIPPER_SCHEDULER_HPP
+
+#include "zipper.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace zipper {
+
+    /**
+       Run many independent merges on a fixed pool of threads.
+
+       Each merge is added with its own cardinality, latency bound
+       and sink and is then identified by a small index.  Any thread
+       may feed nodes to a merge.  A merge is run, that is its fed
+       nodes are moved into it and it is drained with drain_prompt(),
+       only when it has new input or when its @ref merge::deadline()
+       has passed.  An idle merge costs no thread and no wakeup.
+
+       A merge is run by at most one thread at a time and its sink
+       is called from that thread with the nodes drained by the run,
+       in order.  Runs are queued on per-thread deques and idle
+       threads steal from the others.
+
+       The merge clock must follow real time as threads sleep until
+       the next deadline.  Merges must be added before start().
+       Nodes still held when the scheduler is destroyed are dropped.
+    */
+    template <typename Merge>
+    class scheduler {
+    public:
+        using merge_t = Merge;
+        using node_t = typename Merge::node_t;
+        using timepoint_t = typename Merge::timepoint_t;
+        using duration_t = typename Merge::duration_t;
+        using clock_t = typename Merge::clock_t;
+
+        /// Receive the nodes drained by one run of a merge.
+        using sink_t = std::function<void(size_t id, const std::vector<node_t>& nodes)>;
+
+        /// Counts for one merge.
+        struct merge_stats {
+            size_t fed;         // nodes given to feed()
+            size_t rejected;    // nodes the merge rejected as tardy
+            size_t drained;     // nodes passed to the sink
+            size_t runs;        // times the merge was run
+        };
+
+        scheduler()
+            : deques(std::max<size_t>(1, std::thread::hardware_concurrency())) {}
+        scheduler(const scheduler&) = delete;
+        scheduler& operator=(const scheduler&) = delete;
+
+        ~scheduler() {
+            stop();
+        }
+
+        /**
+           Add a merge and return its id.
+
+           Throws std::logic_error once started.
+        */
+        size_t add(size_t k, duration_t max_latency, sink_t sink) {
+            if (!workers.empty()) {
+                throw std::logic_error("scheduler: add merge before start");
+            }
+            slots.push_back(std::make_unique<slot>(k, max_latency, std::move(sink)));
+            return slots.size() - 1;
+        }
+
+        /**
+           Access a merge for configuration, such as add_stream(),
+           before start().
+        */
+        merge_t& get(size_t id) {
+            return slots.at(id)->mq;
+        }
+
+        /// Number of merges.
+        size_t size() const { return slots.size(); }
+
+        /**
+           Start "nthreads" threads, default is one per core.
+
+           A stopped scheduler may be started again and merges fed
+           while it was stopped are then run.  Feeding may overlap
+           start() and stop() as the run deques, one per core, are
+           made once and shared by however many threads run.
+        */
+        void start(size_t nthreads = std::thread::hardware_concurrency()) {
+            if (!workers.empty()) {
+                throw std::logic_error("scheduler: already started");
+            }
+            nthreads = std::max<size_t>(1, nthreads);
+            stopping = false;
+            for (size_t ind = 0; ind < nthreads; ++ind) {
+                workers.emplace_back([this, ind] { work(ind); });
+            }
+        }
+
+        /**
+           Stop and join the threads.  A run in progress completes.
+        */
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& th : workers) {
+                th.join();
+            }
+            workers.clear();
+        }
+
+        /**
+           Feed a node to a merge from any thread.
+        */
+        void feed(size_t id, const node_t& node) {
+            auto& s = *slots.at(id);
+            {
+                std::lock_guard<std::mutex> lk(s.inbox_mutex);
+                s.inbox.push_back(node);
+            }
+            s.fed.fetch_add(1, std::memory_order_relaxed);
+            schedule(id);
+        }
+
+        /**
+           Feed a range of nodes to a merge from any thread.
+        */
+        template<typename InputIterator>
+        void feed_batch(size_t id, InputIterator first, InputIterator last) {
+            auto& s = *slots.at(id);
+            size_t num = 0;
+            {
+                std::lock_guard<std::mutex> lk(s.inbox_mutex);
+                for (; first != last; ++first, ++num) {
+                    s.inbox.push_back(*first);
+                }
+            }
+            s.fed.fetch_add(num, std::memory_order_relaxed);
+            schedule(id);
+        }
+
+        merge_stats stats(size_t id) const {
+            const auto& s = *slots.at(id);
+            return merge_stats{
+                s.fed.load(std::memory_order_relaxed),
+                s.rejected.load(std::memory_order_relaxed),
+                s.drained.load(std::memory_order_relaxed),
+                s.runs.load(std::memory_order_relaxed)};
+        }
+
+    private:
+
+        // Run state of a merge.
+        enum : int { idle, queued, running, rerun };
+
+        struct slot {
+            slot(size_t k, duration_t max_latency, sink_t sink)
+                : mq(k, max_latency), sink(std::move(sink)) {}
+
+            merge_t mq;
+            sink_t sink;
+            std::vector<node_t> work, out; // used only by the runner
+
+            std::mutex inbox_mutex;
+            std::vector<node_t> inbox;
+
+            std::atomic<int> state{idle};
+            timepoint_t armed{timepoint_t::max()}; // guarded by mutex
+
+            std::atomic<size_t> fed{0}, rejected{0}, drained{0}, runs{0};
+        };
+
+        struct alignas(64) task_deque {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        // Make sure the merge will run after this call.
+        void schedule(size_t id) {
+            auto& state = slots[id]->state;
+            int st = state.load();
+            while (true) {
+                if (st == idle) {
+                    if (state.compare_exchange_weak(st, queued)) {
+                        enqueue(id);
+                        return;
+                    }
+                }
+                else if (st == running) {
+                    if (state.compare_exchange_weak(st, rerun)) {
+                        return;
+                    }
+                }
+                else {
+                    return;     // queued or rerun
+                }
+            }
+        }
+
+        static size_t& self() {
+            static thread_local size_t ind = std::numeric_limits<size_t>::max();
+            return ind;
+        }
+
+        void enqueue(size_t id) {
+            size_t which = self();
+            if (which >= deques.size()) {
+                which = next_deque.fetch_add(1, std::memory_order_relaxed) % deques.size();
+            }
+            {
+                auto& dq = deques[which];
+                std::lock_guard<std::mutex> lk(dq.mutex);
+                dq.tasks.push_back(id);
+            }
+            ntasks.fetch_add(1);
+            if (nsleeping.load()) {
+                { std::lock_guard<std::mutex> lk(mutex); }
+                wake.notify_one();
+            }
+        }
+
+        // Take from the back of our own deque or steal from the front
+        // of another.
+        bool dequeue(size_t me, size_t& id) {
+            const size_t n = deques.size();
+            for (size_t off = 0; off < n; ++off) {
+                auto& dq = deques[(me + off) % n];
+                std::lock_guard<std::mutex> lk(dq.mutex);
+                if (dq.tasks.empty()) {
+                    continue;
+                }
+                if (off == 0) {
+                    id = dq.tasks.back();
+                    dq.tasks.pop_back();
+                }
+                else {
+                    id = dq.tasks.front();
+                    dq.tasks.pop_front();
+                }
+                ntasks.fetch_sub(1);
+                return true;
+            }
+            return false;
+        }
+
+        void run(size_t id) {
+            auto& s = *slots[id];
+            s.state.store(running);
+            s.runs.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lk(s.inbox_mutex);
+                std::swap(s.work, s.inbox);
+            }
+            size_t nrejected = 0;
+            for (const auto& node : s.work) {
+                nrejected += !s.mq.feed(node);
+            }
+            s.work.clear();     // keeps capacity
+            if (nrejected) {
+                s.rejected.fetch_add(nrejected, std::memory_order_relaxed);
+            }
+
+            s.out.clear();
+            s.mq.drain_prompt(std::back_inserter(s.out), clock_t::now());
+            if (!s.out.empty()) {
+                s.drained.fetch_add(s.out.size(), std::memory_order_relaxed);
+                s.sink(id, s.out);
+            }
+            arm(id, s.mq.deadline());
+
+            int st = running;
+            if (!s.state.compare_exchange_strong(st, idle)) {
+                // fed while running, go again later
+                s.state.store(queued);
+                enqueue(id);
+            }
+        }
+
+        // Wake the merge at its deadline.
+        void arm(size_t id, const timepoint_t& when) {
+            if (when == timepoint_t::max()) {
+                return;
+            }
+            bool earliest = false;
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                auto& s = *slots[id];
+                if (when >= s.armed) {
+                    return;     // an earlier timer will run it
+                }
+                s.armed = when;
+                earliest = timers.empty() || when < timers.top().first;
+                timers.emplace(when, id);
+                next_due.store(timers.top().first.time_since_epoch().count());
+            }
+            if (earliest) {
+                wake.notify_one();
+            }
+        }
+
+        // Schedule merges with passed deadlines, mutex must be held.
+        void fire(const timepoint_t& now, std::vector<size_t>& due) {
+            while (!timers.empty() && timers.top().first <= now) {
+                const auto [when, id] = timers.top();
+                timers.pop();
+                auto& s = *slots[id];
+                if (s.armed == when) { // else superseded
+                    s.armed = timepoint_t::max();
+                    due.push_back(id);
+                }
+            }
+            next_due.store(timers.empty()
+                           ? timepoint_t::max().time_since_epoch().count()
+                           : timers.top().first.time_since_epoch().count());
+        }
+
+        void work(size_t me) {
+            self() = me;
+            std::vector<size_t> due;
+            while (!stopping) {
+                const auto now = clock_t::now();
+                if (now.time_since_epoch().count() >= next_due.load()) {
+                    {
+                        std::lock_guard<std::mutex> lk(mutex);
+                        fire(now, due);
+                    }
+                    for (auto id : due) {
+                        schedule(id);
+                    }
+                    due.clear();
+                }
+
+                size_t id;
+                if (dequeue(me, id)) {
+                    run(id);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lk(mutex);
+                nsleeping.fetch_add(1);
+                auto ready = [&] {
+                    return stopping || ntasks.load() > 0
+                        || clock_t::now().time_since_epoch().count() >= next_due.load();
+                };
+                if (timers.empty()) {
+                    wake.wait(lk, ready);
+                }
+                else {
+                    const auto dt = timers.top().first - clock_t::now();
+                    wake.wait_for(lk, std::chrono::duration_cast<std::chrono::nanoseconds>(dt), ready);
+                }
+                nsleeping.fetch_sub(1);
+            }
+        }
+
+        std::vector<std::unique_ptr<slot>> slots;
+        std::vector<task_deque> deques; // never resized
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next_deque{0};
+        std::atomic<size_t> ntasks{0};
+        std::atomic<size_t> nsleeping{0};
+
+        using timer_t = std::pair<timepoint_t, size_t>;
+        std::mutex mutex;       // guards timers and armed
+        std::condition_variable wake;
+        std::priority_queue<timer_t, std::vector<timer_t>, std::greater<timer_t>> timers;
+        std::atomic<typename duration_t::rep> next_due{timepoint_t::max().time_since_epoch().count()};
+        std::atomic<bool> stopping{false};
+    };
+}
+#endif
@@ -0,0 +1,373 @@
+#ifndef ZIPPER_SHM_HPP
+#define ZIPPER_SHM_HPP
+
+#include "zipper.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace zipper {
+
+    /**
+       A single producer, single consumer ring of fixed size slots in
+       a POSIX shared memory segment.
+
+       Each slot holds an ordering value and a payload which must be
+       trivially copyable.  The producer and consumer may be in
+       different processes.  Typically the merge side creates one ring
+       per stream identity and each producer process opens its ring
+       by name.
+
+       The consumer reads slots in place and releases them, in order,
+       when done which returns them to the producer.
+
+       Errors in creating or opening the segment throw std::system_error.
+    */
+    template <typename T, typename Ordering = size_t>
+    class shm_ring {
+    public:
+        using payload_t = T;
+        using ordering_t = Ordering;
+        using seq_t = uint64_t;
+
+        struct slot_t {
+            ordering_t ordering;
+            payload_t payload;
+        };
+
+        static_assert(std::is_trivially_copyable<slot_t>::value,
+                      "shm_ring slots must be trivially copyable");
+        static_assert(std::atomic<seq_t>::is_always_lock_free,
+                      "shm_ring needs lock-free atomics");
+
+        /**
+           Create a new segment with room for at least "capacity"
+           slots, rounded up to a power of two.  An existing segment
+           of the same name is replaced.
+        */
+        static shm_ring create(const std::string& name, size_t capacity) {
+            size_t cap = 1;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+            ::shm_unlink(name.c_str());
+            int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) {
+                throw_errno("shm_open " + name);
+            }
+            const size_t bytes = sizeof(header) + cap * sizeof(slot_t);
+            if (::ftruncate(fd, bytes) < 0) {
+                ::close(fd);
+                throw_errno("ftruncate " + name);
+            }
+            shm_ring ring(fd, bytes, name);
+            new (ring.hdr) header{magic, cap, sizeof(slot_t)};
+            return ring;
+        }
+
+        /**
+           Open an existing segment made by create().
+        */
+        static shm_ring open(const std::string& name) {
+            int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd < 0) {
+                throw_errno("shm_open " + name);
+            }
+            struct stat st;
+            if (::fstat(fd, &st) < 0) {
+                ::close(fd);
+                throw_errno("fstat " + name);
+            }
+            shm_ring ring(fd, st.st_size, name);
+            const auto* h = ring.hdr;
+            if (ring.bytes < sizeof(header) || h->magic != magic ||
+                h->slot_size != sizeof(slot_t) ||
+                ring.bytes < sizeof(header) + h->capacity * sizeof(slot_t)) {
+                throw std::system_error(EINVAL, std::generic_category(),
+                                        "not a matching shm_ring: " + name);
+            }
+            return ring;
+        }
+
+        /// Remove the segment name.  Mapped rings remain usable.
+        static void unlink(const std::string& name) {
+            ::shm_unlink(name.c_str());
+        }
+
+        shm_ring(shm_ring&& other) noexcept
+            : hdr(other.hdr), bytes(other.bytes), name_(std::move(other.name_)) {
+            other.hdr = nullptr;
+        }
+        shm_ring& operator=(shm_ring&& other) noexcept {
+            std::swap(hdr, other.hdr);
+            std::swap(bytes, other.bytes);
+            std::swap(name_, other.name_);
+            return *this;
+        }
+        shm_ring(const shm_ring&) = delete;
+        shm_ring& operator=(const shm_ring&) = delete;
+
+        ~shm_ring() {
+            if (hdr) {
+                ::munmap(hdr, bytes);
+            }
+        }
+
+        const std::string& name() const { return name_; }
+        size_t capacity() const { return hdr->capacity; }
+
+        // Producer side.
+
+        /**
+           Return the next free slot to fill in place or nullptr if the
+           ring is full.  Make it visible with publish().
+        */
+        slot_t* claim() {
+            const seq_t h = hdr->head.load(std::memory_order_relaxed);
+            if (h - hdr->tail.load(std::memory_order_acquire) >= hdr->capacity) {
+                return nullptr;
+            }
+            return &slots()[h & (hdr->capacity - 1)];
+        }
+
+        void publish() {
+            hdr->head.fetch_add(1, std::memory_order_release);
+        }
+
+        /// Copy a value into the ring, return false if full.
+        bool push(const ordering_t& ord, const payload_t& pay) {
+            slot_t* s = claim();
+            if (!s) {
+                return false;
+            }
+            s->ordering = ord;
+            s->payload = pay;
+            publish();
+            return true;
+        }
+
+        // Consumer side.
+
+        /// Sequence number one past the last published slot.
+        seq_t head() const {
+            return hdr->head.load(std::memory_order_acquire);
+        }
+
+        /// Sequence number of the oldest unreleased slot.
+        seq_t tail() const {
+            return hdr->tail.load(std::memory_order_relaxed);
+        }
+
+        /// The slot of a published, unreleased sequence number.
+        const slot_t& at(seq_t seq) const {
+            return slots()[seq & (hdr->capacity - 1)];
+        }
+
+        /**
+           The sequence number of an unreleased slot given the
+           address of its payload.
+        */
+        seq_t seq_of(const payload_t* pay) const {
+            const auto* base = reinterpret_cast<const char*>(&slots()[0].payload);
+            const seq_t ind = (reinterpret_cast<const char*>(pay) - base) / sizeof(slot_t);
+            const seq_t t = tail();
+            return t + ((ind - t) & (hdr->capacity - 1));
+        }
+
+        /// Return slots before seq to the producer.
+        void release_to(seq_t seq) {
+            hdr->tail.store(seq, std::memory_order_release);
+        }
+
+    private:
+
+        static constexpr uint64_t magic = 0x7a69707065727368; // "zippersh"
+
+        struct header {
+            uint64_t magic;
+            uint64_t capacity;
+            uint64_t slot_size;
+            alignas(64) std::atomic<seq_t> head{0};
+            alignas(64) std::atomic<seq_t> tail{0};
+        };
+
+        shm_ring(int fd, size_t bytes, const std::string& name)
+            : bytes(bytes), name_(name) {
+            void* addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, 0);
+            const int err = errno;
+            ::close(fd);
+            if (addr == MAP_FAILED) {
+                throw std::system_error(err, std::generic_category(), "mmap " + name);
+            }
+            hdr = static_cast<header*>(addr);
+        }
+
+        slot_t* slots() const {
+            return reinterpret_cast<slot_t*>(reinterpret_cast<char*>(hdr) + sizeof(header));
+        }
+
+        [[noreturn]] static void throw_errno(const std::string& what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        header* hdr{nullptr};
+        size_t bytes{0};
+        std::string name_;
+    };
+
+    /**
+       Feed a merge from shm_ring's without copying payloads.
+
+       The merge payload must be a const pointer to the ring payload
+       type.
+       Nodes fed point into the ring slots.  Once a node drained from
+       the merge is no longer needed, give it to release() to return
+       its slot to the producer.  Nodes may be released in any order
+       and a slot returns to the producer once all prior slots of
+       its stream are released.
+
+       Slots of nodes rejected by the merge are released
+       automatically, except for those the merge keeps as late
+       nodes, see @ref merge::keep_late().  Release those after
+       taking them with drain_late().
+
+       Remove nodes from the merge with this source's erase_if() or
+       clear() so that their slots are released too.
+    */
+    template <typename Merge>
+    class shm_source {
+    public:
+        using merge_t = Merge;
+        using node_t = typename Merge::node_t;
+        using traits_t = typename Merge::traits_t;
+        using identity_t = typename Merge::identity_t;
+        using ordering_t = typename Merge::ordering_t;
+        using timepoint_t = typename Merge::timepoint_t;
+        using clock_t = typename Merge::clock_t;
+        using pointer_t = typename Merge::payload_t;
+        static_assert(std::is_pointer<pointer_t>::value,
+                      "shm_source needs a merge of pointer payloads");
+        using payload_t = typename std::remove_cv<
+            typename std::remove_pointer<pointer_t>::type>::type;
+        using ring_t = shm_ring<payload_t, ordering_t>;
+
+        /// Take the consumer side of a ring providing the stream.
+        void add(const identity_t& ident, ring_t&& ring) {
+            index[ident] = inputs.size();
+            inputs.push_back(input{ident, std::move(ring)});
+            inputs.back().fed = inputs.back().ring.tail();
+        }
+
+        /**
+           Feed up to "most" newly published slots from each ring to
+           the merge, stamped with the given debut.  Return the
+           number of nodes accepted.
+        */
+        size_t poll(merge_t& mq, size_t most = 1024,
+                    const timepoint_t& debut = clock_t::now())
+        {
+            size_t naccepted = 0;
+            for (auto& in : inputs) {
+                const auto head = in.ring.head();
+                for (size_t num = 0; num < most && in.fed < head; ++num) {
+                    const auto& slot = in.ring.at(in.fed++);
+                    const size_t nlate = mq.late_size();
+                    const bool ok = mq.feed(traits_t::make(&slot.payload, slot.ordering,
+                                                           in.ident, debut));
+                    const bool kept = !ok && mq.late_size() > nlate;
+                    in.held.push_back(!ok && !kept);
+                    naccepted += ok;
+                }
+                in.forget();
+            }
+            return naccepted;
+        }
+
+        /// Return the slot of a drained or late node to its producer.
+        void release(const node_t& node) {
+            auto& in = inputs[index.at(traits_t::identity(node))];
+            const auto seq = in.ring.seq_of(traits_t::payload(node));
+            in.held.at(seq - in.ring.tail()) = true;
+            in.forget();
+        }
+
+        /**
+           Remove held nodes with merge::erase_if() and release the
+           slots of those from this source.
+
+           Erasing through the merge itself would leave their slots
+           held and in time stall the producers.
+        */
+        template <typename Pred>
+        size_t erase_if(merge_t& mq, Pred pred) {
+            return mq.erase_if([&](const node_t& node) {
+                if (!pred(node)) {
+                    return false;
+                }
+                if (index.count(traits_t::identity(node))) {
+                    release(node);
+                }
+                return true;
+            });
+        }
+
+        /**
+           Clear the merge with merge::clear() and release the slots
+           of its held and late nodes from this source.
+        */
+        void clear(merge_t& mq) {
+            erase_if(mq, [](const node_t&) { return true; });
+            std::vector<typename merge_t::late_node> late;
+            mq.drain_late(std::back_inserter(late));
+            for (const auto& ln : late) {
+                if (index.count(traits_t::identity(ln.node))) {
+                    release(ln.node);
+                }
+            }
+            mq.clear();
+        }
+
+        /// Number of slots fed but not yet released for a stream.
+        size_t held(const identity_t& ident) const {
+            return inputs[index.at(ident)].held.size();
+        }
+
+    private:
+        struct input {
+            identity_t ident;
+            ring_t ring;
+            typename ring_t::seq_t fed{0};
+            // Slots fed but not returned, true once released.
+            std::deque<bool> held{};
+
+            // Return the released slots at the tail.
+            void forget() {
+                auto tail = ring.tail();
+                while (!held.empty() && held.front()) {
+                    held.pop_front();
+                    ++tail;
+                }
+                if (tail != ring.tail()) {
+                    ring.release_to(tail);
+                }
+            }
+        };
+        std::vector<input> inputs;
+        std::unordered_map<identity_t, size_t> index;
+    };
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef ZIPPER_TRACE_HPP
+#define ZIPPER_TRACE_HPP
+
+#include "zipper.hpp"
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <type_traits>
+
+namespace zipper {
+
+    /**
+       A merge Trace recording timestamped events.
+
+       Each thread writes to its own ring of the given Capacity of
+       events, overwriting the oldest.  Recording is lock-free and
+       does not allocate after the first event on a thread.  Time is
+       taken from @ref tsc_clock.
+
+       The rings of all threads may be dumped as Chrome trace JSON,
+       which Perfetto and chrome://tracing load.  Dump when threads
+       are not recording or events being written may appear torn.
+
+       Use it as the Trace parameter of the merge:
+
+         using merge_t = zipper::merge<node_t, zipper::heap_queue<node_t>,
+                                       zipper::ring_trace<>>;
+    */
+    template <size_t Capacity = (1<<16)>
+    class ring_trace {
+    public:
+        using clock_t = tsc_clock<>;
+
+        struct event {
+            clock_t::time_point when;
+            const char* name;   // static string
+            char phase;         // Chrome trace "ph"
+            long long ident, ord;
+        };
+
+        static void begin(probe p) {
+            record(probe_name(p), 'B');
+        }
+        static void end(probe p) {
+            record(probe_name(p), 'E');
+        }
+        template<typename Node>
+        static void accept(const Node& node) {
+            record("accept", 'i', arg(node_traits<Node>::identity(node)),
+                   arg(node_traits<Node>::ordering(node)));
+        }
+        template<typename Node>
+        static void reject(const Node& node) {
+            record("reject", 'i', arg(node_traits<Node>::identity(node)),
+                   arg(node_traits<Node>::ordering(node)));
+        }
+        template<typename Node>
+        static void pop(const Node& node) {
+            record("pop", 'i', arg(node_traits<Node>::identity(node)),
+                   arg(node_traits<Node>::ordering(node)));
+        }
+        static void decide(bool complete) {
+            record(complete ? "complete" : "incomplete", 'i');
+        }
+        template<typename Identity>
+        static void stale(const Identity& ident) {
+            record("stale", 'i', arg(ident));
+        }
+
+        /**
+           Return the events of each thread's ring, oldest first.
+        */
+        static std::vector<std::vector<event>> events() {
+            std::vector<std::vector<event>> ret;
+            auto& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (const auto& r : reg.rings) {
+                ret.push_back(r->read());
+            }
+            return ret;
+        }
+
+        /**
+           Write all events as Chrome trace JSON.
+        */
+        static void dump(std::ostream& out) {
+            const auto all = events();
+            out << "{\"traceEvents\":[";
+            const char* comma = "\n";
+            for (size_t tid = 0; tid < all.size(); ++tid) {
+                for (const auto& e : all[tid]) {
+                    const double us = e.when.time_since_epoch().count() * 1e-3;
+                    out << comma << "{\"name\":\"" << e.name << "\""
+                        << ",\"ph\":\"" << e.phase << "\""
+                        << ",\"ts\":" << std::fixed << us
+                        << ",\"pid\":0,\"tid\":" << tid;
+                    if (e.phase == 'i') {
+                        out << ",\"s\":\"t\",\"args\":{\"ident\":" << e.ident
+                            << ",\"ord\":" << e.ord << "}";
+                    }
+                    out << "}";
+                    comma = ",\n";
+                }
+            }
+            out << "\n]}\n";
+        }
+
+        static void dump(const std::string& filename) {
+            std::ofstream out(filename);
+            dump(out);
+        }
+
+      private:
+
+        // Single writer ring.  The head counts all events written.
+        struct ring {
+            std::array<event, Capacity> slots;
+            std::atomic<size_t> head{0};
+
+            void write(const event& e) {
+                const size_t h = head.load(std::memory_order_relaxed);
+                slots[h % Capacity] = e;
+                head.store(h + 1, std::memory_order_release);
+            }
+
+            std::vector<event> read() const {
+                const size_t h = head.load(std::memory_order_acquire);
+                const size_t first = h > Capacity ? h - Capacity : 0;
+                std::vector<event> ret;
+                ret.reserve(h - first);
+                for (size_t ind = first; ind < h; ++ind) {
+                    ret.push_back(slots[ind % Capacity]);
+                }
+                return ret;
+            }
+        };
+
+        // Rings outlive their threads so they may be dumped at exit.
+        struct rings_t {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ring>> rings;
+        };
+        static rings_t& registry() {
+            static rings_t reg;
+            return reg;
+        }
+
+        static ring& local() {
+            static thread_local std::shared_ptr<ring> mine = [] {
+                auto r = std::make_shared<ring>();
+                auto& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.rings.push_back(r);
+                return r;
+            }();
+            return *mine;
+        }
+
+        static void record(const char* name, char phase,
+                           long long ident = 0, long long ord = 0) {
+            local().write(event{clock_t::now(), name, phase, ident, ord});
+        }
+
+        template<typename T>
+        static long long arg(const T& val) {
+            if constexpr (std::is_arithmetic<T>::value) {
+                return static_cast<long long>(val);
+            }
+            else {
+                return 0;
+            }
+        }
+    };
+}
+
+#endif